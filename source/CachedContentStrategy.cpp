@@ -0,0 +1,20 @@
+#include "CachedContentStrategy.h"
+#include "Fingerprint.h"
+
+CachedContentStrategy::CachedContentStrategy(std::unique_ptr<ContentStrategy> strategy, TextCache &cache)
+    : strategy_(std::move(strategy)), cache_(cache) {}
+
+std::string CachedContentStrategy::read_content(const std::string &filepath) const {
+    return read_fingerprinted_content(filepath, Fingerprint::of_file(filepath));
+}
+
+std::string CachedContentStrategy::read_fingerprinted_content(const std::string &filepath,
+                                                              const Fingerprint &fingerprint) const {
+    if (auto cached = cache_.get(filepath, fingerprint)) {
+        return std::move(*cached);
+    }
+
+    std::string content = strategy_->read_content(filepath);
+    cache_.put(filepath, fingerprint, content);
+    return content;
+}
@@ -0,0 +1,25 @@
+#ifndef _H_CACHEDCONTENTSTRATEGY
+#define _H_CACHEDCONTENTSTRATEGY
+
+#include <memory>
+
+#include "ContentStrategy.h"
+#include "TextCache.h"
+
+/*
+ *   Decorator for expensive Content Strategies (PDF, XML)
+ *   looks up the extracted text in the text cache first and only runs the
+ *   wrapped strategy on a miss, the result is stored in the cache
+ */
+class CachedContentStrategy : public ContentStrategy {
+   public:
+    CachedContentStrategy(std::unique_ptr<ContentStrategy> strategy, TextCache &cache);
+    std::string read_content(const std::string &filepath) const;
+    std::string read_fingerprinted_content(const std::string &filepath, const Fingerprint &fingerprint) const;
+
+   private:
+    std::unique_ptr<ContentStrategy> strategy_;
+    TextCache &cache_;
+};
+
+#endif
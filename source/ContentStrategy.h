@@ -3,10 +3,17 @@
 
 #include <string>
 
+#include "Fingerprint.h"
+
 class ContentStrategy {
    public:
     virtual ~ContentStrategy() = default;
     virtual std::string read_content(const std::string &filepath) const = 0;
+
+    /* for a file the caller has fingerprinted already, only strategies keyed by the content use it */
+    virtual std::string read_fingerprinted_content(const std::string &filepath, const Fingerprint &) const {
+        return read_content(filepath);
+    }
 };
 
 #endif
\ No newline at end of file
@@ -1,54 +1,71 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
 #include <filesystem>
-#include <iostream>
 #include <fstream>
+#include <limits>
 #include <vector>
 
 #include "Document.h"
+#include "Logger.h"
 
 /* Base Document Class */
 Document::Document(std::string filepath, std::string file_extension, std::unique_ptr<ContentStrategy> strategy)
-    : filepath(filepath), file_extension(file_extension), strategy_(std::move(strategy))
+    : filepath(filepath), file_extension(file_extension), strategy_(std::move(strategy)),
+      concordance(std::make_unique<TermTable<TermOccurrence>>()),
+      tfidf_scores(std::make_unique<TermTable<double>>())
 {
 }
 
-std::unordered_map<std::string, int> Document::get_concordance() {
-    return concordance;
+const TermMap<TermOccurrence> &Document::get_concordance() const {
+    return concordance->terms;
 }
 
 void Document::print_tfidf_scores() {
-    std::cout << "Doc: " << filepath << std::endl;
-    for (const auto &entry: tfidf_scores) {
-        std::cout << entry.first << " Score: " << entry.second << std::endl;
+    Logger::info(LogComponent::DOCUMENT, "Doc: ", filepath);
+    for (const auto &entry: tfidf_scores->terms) {
+        Logger::info(LogComponent::DOCUMENT, entry.first, " Score: ", entry.second);
     }    
 }
 
-void Document::insert_tfidf_score(std::pair<std::string, double> tfidf_score) {
-    tfidf_scores.insert(tfidf_score);
+void Document::reset_tfidf_scores() {
+    tfidf_scores = std::make_unique<TermTable<double>>(tfidf_scores->terms.size());
+}
+
+void Document::insert_tfidf_score(std::string_view term, double tfidf_score) {
+    tfidf_scores->terms.emplace(term, tfidf_score);
 }
 
 /*
  * 	returns the tfidf score of the term
  * 	returns 0 if the term is not in the Document
  */
-double Document::get_tfidf_score(const std::string &term) {
-    if (tfidf_scores.contains(term)) {
-        return tfidf_scores.at(term);
+double Document::get_tfidf_score(std::string_view term) {
+    auto it = tfidf_scores->terms.find(term);
+    if (it != tfidf_scores->terms.end()) {
+        return it->second;
     }
 
     return 0.0;
 }
 
+uint32_t Document::get_id() const { return id; }
+
+void Document::set_id(uint32_t id) { this->id = id; }
+
 std::string Document::get_filepath() const { return filepath; }
 
 std::string Document::get_extension() { return file_extension; }
 
 /* number of times, a word occurs in a given document */
-int Document::get_term_frequency(const std::string &term) {
-    if (concordance.find(term) != concordance.end()) {
-        return concordance.at(term);
-    }
+int Document::get_term_frequency(std::string_view term) {
+    const TermOccurrence *occurrence = get_occurrence(term);
+    return occurrence != nullptr ? occurrence->count : 0;
+}
 
-    return 0;
+const TermOccurrence *Document::get_occurrence(std::string_view term) const {
+    auto it = concordance->terms.find(term);
+    return it != concordance->terms.end() ? &it->second : nullptr;
 }
 
 std::string Document::get_file_content_as_string() {
@@ -56,38 +73,113 @@ std::string Document::get_file_content_as_string() {
     return file_content;
 }
 
-bool Document::contains_term(const std::string &term) {
-    if (concordance.find(term) != concordance.end()) {
-        return true;
-    }
-    return false;
+bool Document::contains_term(std::string_view term) {
+    return concordance->terms.contains(term);
 }
 
-void Document::index_document() {
-    std::string word;
-    std::istringstream iss(read_content());
+/*
+ *   builds a new generation of the concordance, the previous one is released
+ *   as a whole once the new one is complete
+ *   the offset of a term is the start of the whitespace separated token it was split from
+ */
+void Document::index_document(DocumentStore *store) {
+    /* taken before reading, so a change while indexing is seen by the next check */
+    const auto started = std::chrono::system_clock::now();
+    std::string content = read_content();
 
-    std::cout << "Indexing doc : " << this->get_filepath() << std::endl;
+    Logger::debug(LogComponent::DOCUMENT, "Indexing doc : ", this->get_filepath());
+
+    /*
+     *  scratch arena for the words split off a single token,
+     *  backed by a per thread buffer and reset after every token
+     */
+    thread_local std::array<std::byte, 16 * 1024> scratch_buffer;
+    std::pmr::monotonic_buffer_resource scratch(scratch_buffer.data(), scratch_buffer.size());
+
+    auto next_generation = std::make_unique<TermTable<TermOccurrence>>(concordance->terms.size());
+    std::string word;
+    size_t pos = 0;
+    while (pos < content.size()) {
+        /* read the next whitespace separated token */
+        while (pos < content.size() && std::isspace(static_cast<unsigned char>(content[pos]))) {
+            ++pos;
+        }
+        size_t end = pos;
+        while (end < content.size() && !std::isspace(static_cast<unsigned char>(content[end]))) {
+            ++end;
+        }
+        if (end == pos) {
+            break;
+        }
+        word.assign(content, pos, end - pos);
+        uint32_t offset = static_cast<uint32_t>(std::min<size_t>(pos, std::numeric_limits<uint32_t>::max()));
+        pos = end;
 
-    while (iss >> word) {
         /* split the word if necessary */
-        std::vector<std::string> clean_words = clean_word(word);
-        for (auto &clean_word : clean_words) {
-            if (clean_word.find_first_not_of(' ') != std::string::npos) {
-                if (concordance.find(clean_word) != concordance.end()) {
-                    concordance[clean_word]++;
+        {
+            std::pmr::vector<std::pmr::string> clean_words = clean_word(word, &scratch);
+            for (auto &clean_word : clean_words) {
+                auto it = next_generation->terms.find(std::string_view(clean_word));
+                if (it != next_generation->terms.end()) {
+                    it->second.count++;
                 } else {
-                    concordance[clean_word] = 1;
+                    next_generation->terms.emplace(clean_word, TermOccurrence{1, offset});
                 }
             }
         }
+        scratch.release();
+    }
+
+    if (store != nullptr) {
+        store->put(id, content);
     }
+    concordance = std::move(next_generation);
+    indexed_at = started;
+    indexed_fingerprint = fingerprint;
+}
+
+const Fingerprint &Document::get_fingerprint() const { return fingerprint; }
 
-    indexed_at = std::chrono::system_clock::now();
+void Document::refresh_fingerprint() {
+    fingerprint = Fingerprint::of_file(filepath);
 }
 
+bool Document::is_alias() const { return alias_of != nullptr; }
+
+Document *Document::get_alias_of() const { return alias_of; }
+
+const std::vector<Document *> &Document::get_aliases() const { return aliases; }
+
+void Document::add_alias(Document *alias) {
+    alias->alias_of = this;
+    alias->clear_postings();
+    alias->indexed_at = std::chrono::system_clock::now();
+    alias->indexed_fingerprint = alias->fingerprint;
+    aliases.push_back(alias);
+}
+
+void Document::remove_alias(Document *alias) {
+    std::erase(aliases, alias);
+    alias->alias_of = nullptr;
+}
+
+void Document::adopt_postings(Document &other) {
+    concordance = std::move(other.concordance);
+    tfidf_scores = std::move(other.tfidf_scores);
+    other.clear_postings();
+}
+
+void Document::clear_postings() {
+    concordance = std::make_unique<TermTable<TermOccurrence>>();
+    tfidf_scores = std::make_unique<TermTable<double>>();
+}
+
+/* the fingerprint is refreshed before every (re)indexing, so the cache lookup can use it */
 std::string Document::read_content() {
-    return strategy_->read_content(filepath);
+    if (fingerprint == Fingerprint{}) {
+        return strategy_->read_content(filepath);
+    }
+    return strategy_->read_fingerprinted_content(filepath, fingerprint);
 }
 
 /*
@@ -95,6 +187,14 @@ std::string Document::read_content() {
 */
 std::vector<std::string> Document::clean_word(std::string &word) {
     std::vector<std::string> clean_words;
+    for (auto &clean_word : clean_word(word, std::pmr::get_default_resource())) {
+        clean_words.emplace_back(clean_word);
+    }
+    return clean_words;
+}
+
+std::pmr::vector<std::pmr::string> Document::clean_word(std::string &word, std::pmr::memory_resource *resource) {
+    std::pmr::vector<std::pmr::string> clean_words(resource);
     /* transform every word to lower case letters */
     std::transform(word.begin(), word.end(), word.begin(),
                    [](auto c) { return std::tolower(c); });
@@ -102,30 +202,47 @@ std::vector<std::string> Document::clean_word(std::string &word) {
     /* remove special characters */
     std::replace_if(
         word.begin(), word.end(),
-        [](auto c) { return std::ispunct(c) || std::isdigit(c); }, ' ');
+        [](auto c) { return std::ispunct(c) || std::isdigit(c) || std::isspace(c); }, ' ');
 
     /* split the word if neccessary and append to result vector */
-    std::stringstream iss(word);
-    std::string split_word;
-    while (iss >> split_word) {
-        clean_words.push_back(split_word);
+    size_t pos = 0;
+    while ((pos = word.find_first_not_of(' ', pos)) != std::string::npos) {
+        size_t end = word.find(' ', pos);
+        if (end == std::string::npos) {
+            end = word.size();
+        }
+        clean_words.emplace_back(std::string_view(word).substr(pos, end - pos));
+        pos = end;
     }
     return clean_words;
 }
 
 /*
  * checks indexed_at time against the last modification of the file
- * if the file was modified after it was indexed, it needs to be indexed again,
- * and the function returns true, otherwise the function returns false
+ * if the file was modified after it was indexed, size and content hash are
+ * compared against the fingerprint of the last successful indexing, only if the
+ * content changed or the indexing failed the function returns true and the
+ * document needs to be indexed again, indexed_at is only advanced by the indexing
+ * a touched but unchanged file is marked as checked and returns false
  * TODO: Move to index
  */
 bool Document::needs_reindexing() {
     try {
         std::filesystem::file_time_type ftime = std::filesystem::last_write_time(this->get_filepath());
         std::chrono::time_point tp = std::chrono::file_clock::to_sys(ftime);
-        return tp > this->indexed_at;
+        if (tp <= this->indexed_at) {
+            return false;
+        }
+
+        refresh_fingerprint();
+        if (fingerprint == indexed_fingerprint) {
+            indexed_at = std::chrono::system_clock::now();
+            Logger::debug(LogComponent::DOCUMENT, "Content unchanged, skip reindexing: ", filepath);
+            return false;
+        }
+        return true;
     } catch (std::exception &e) {
-        std::cerr << "Error ocurred: " << e.what() << std::endl;
+        Logger::error(LogComponent::DOCUMENT, "Error ocurred: ", e.what());
         return false;
     }
 }
@@ -2,11 +2,23 @@
 #define _H_DOCUMENT
 
 #include <chrono>
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 
 #include "ContentStrategy.h"
+#include "DocumentStore.h"
+#include "Fingerprint.h"
+#include "TermTable.h"
+
+/* number of times a term occurs in a document and the offset of its first occurrence in the text */
+struct TermOccurrence {
+    int count;
+    uint32_t first_offset;
+};
 
 /* 
 *   Uses Strategy Design Pattern to get rid of inheritance
@@ -19,38 +31,78 @@ class Document {
     /* TODO: make document independant of the filepath, rather use a title or document name or id */
     Document(std::string filepath, std::string file_extension, std::unique_ptr<ContentStrategy> strategy);
 
-    /* fills the concordance from the content of the document */
-    void index_document();
+    /* fills the concordance from the content of the document, the text is kept in the store if given */
+    void index_document(DocumentStore *store = nullptr);
 
     void print_tfidf_scores();
-    void insert_tfidf_score(std::pair<std::string, double> tfidf_score);
+
+    /* drops the tfidf scores of the last build, call before inserting new ones */
+    void reset_tfidf_scores();
+    void insert_tfidf_score(std::string_view term, double tfidf_score);
+
+    /* the position of the document in the index, used in postings */
+    uint32_t get_id() const;
+    void set_id(uint32_t id);
 
     /* getter functions */
-    double get_tfidf_score(const std::string &term);
-    int get_term_frequency(const std::string &term);
-    std::unordered_map<std::string, int> get_concordance();
+    double get_tfidf_score(std::string_view term);
+    int get_term_frequency(std::string_view term);
+    /* nullptr if the document doesnt contain the term */
+    const TermOccurrence *get_occurrence(std::string_view term) const;
+    const TermMap<TermOccurrence> &get_concordance() const;
     std::string get_filepath() const;
     std::string get_extension();
     std::string get_file_content_as_string();
 
-    bool contains_term(const std::string &term);
+    bool contains_term(std::string_view term);
     bool needs_reindexing();
 
+    /* size and content hash of the file, as of the last refresh */
+    const Fingerprint &get_fingerprint() const;
+    void refresh_fingerprint();
+
+    /*
+     *   Documents with identical content are indexed once, the first one is the
+     *   canonical document and holds the postings, the others are its aliases
+     */
+    bool is_alias() const;
+    Document *get_alias_of() const;
+    const std::vector<Document *> &get_aliases() const;
+    void add_alias(Document *alias);
+    void remove_alias(Document *alias);
+
+    /* takes over the concordance and scores of a document with the same content */
+    void adopt_postings(Document &other);
+    void clear_postings();
+
     static std::vector<std::string> clean_word(std::string &word);
 
+    /* same as above, the result is allocated from the given memory resource */
+    static std::pmr::vector<std::pmr::string> clean_word(std::string &word, std::pmr::memory_resource *resource);
+
    private:
     std::string read_content();
 
+    uint32_t id = 0;
     std::string filepath;
     std::string file_extension;
     std::unique_ptr<ContentStrategy> strategy_;
+    /* time and content of the last successful indexing, a failed one is retried */
     std::chrono::system_clock::time_point indexed_at;
+    Fingerprint indexed_fingerprint;
+    Fingerprint fingerprint;
+
+    Document *alias_of = nullptr;
+    std::vector<Document *> aliases;
 
-    /* every term in the document and a counter for that term */
-    std::unordered_map<std::string, int> concordance;
+    /*
+     *   every term in the document, a counter and the first position of that term,
+     *   a new generation is built on every index_document call
+     */
+    std::unique_ptr<TermTable<TermOccurrence>> concordance;
 
-    /* every term in the document and its tfidf score */
-    std::unordered_map<std::string, double> tfidf_scores;
+    /* every term in the document and its tfidf score, a new generation per tfidf build */
+    std::unique_ptr<TermTable<double>> tfidf_scores;
 };
 
 #endif
\ No newline at end of file
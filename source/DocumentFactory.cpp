@@ -1,15 +1,15 @@
-#include <iostream>
-
+#include "CachedContentStrategy.h"
 #include "DocumentFactory.h"
+#include "Logger.h"
 #include "PDFContentStrategy.h"
 #include "XMLContentStrategy.h"
 #include "TextContentStrategy.h"
 
 std::unique_ptr<Document> DocumentFactory::create_document(
-    const std::string &filepath, const std::string &extension) {
+    const std::string &filepath, const std::string &extension, TextCache *cache) {
 
     if (extension == ".xml" || extension == ".xhtml") {
-        return std::make_unique<Document>(filepath, extension, std::make_unique<XMLContentStrategy>());
+        return std::make_unique<Document>(filepath, extension, cached(std::make_unique<XMLContentStrategy>(), cache));
     }
 
     if (extension == ".txt") {
@@ -18,12 +18,18 @@ std::unique_ptr<Document> DocumentFactory::create_document(
 
     if (extension == ".pdf") {
         try {
-            return std::make_unique<Document>(filepath, extension, std::make_unique<PDFContentStrategy>());
+            return std::make_unique<Document>(filepath, extension, cached(std::make_unique<PDFContentStrategy>(), cache));
         } catch (std::exception &e) {
-            std::cerr << "Exception caught creating pdf document: " << e.what();
-            std::cerr << std::endl;
+            Logger::error(LogComponent::DOCUMENT, "Exception caught creating pdf document: ", e.what());
         }
     }
 
     throw std::runtime_error(std::string("Document " + filepath + " " + extension + " not supported"));
-};
\ No newline at end of file
+};
+
+std::unique_ptr<ContentStrategy> DocumentFactory::cached(std::unique_ptr<ContentStrategy> strategy, TextCache *cache) {
+    if (cache == nullptr) {
+        return strategy;
+    }
+    return std::make_unique<CachedContentStrategy>(std::move(strategy), *cache);
+}
\ No newline at end of file
@@ -4,15 +4,20 @@
 #include <memory>
 
 #include "Document.h"
+#include "TextCache.h"
 
 /* 
 *   a Factory which returns Document objects depending on a file extension 
 *   throws Exception if the file extension is not implemented
+*   if a text cache is given, expensive extractions (PDF, XML) go through it
 */
 class DocumentFactory {
    public:
     static std::unique_ptr<Document> create_document(
-        const std::string &filepath, const std::string &extension);
+        const std::string &filepath, const std::string &extension, TextCache *cache = nullptr);
+
+   private:
+    static std::unique_ptr<ContentStrategy> cached(std::unique_ptr<ContentStrategy> strategy, TextCache *cache);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include "DocumentStore.h"
+#include "Logger.h"
+
+namespace {
+
+constexpr const char *FILENAME = "documents.store";
+
+/* garbage is only compacted once there is at least this much of it */
+constexpr uint64_t MIN_COMPACT_BYTES = 16 * 1024 * 1024;
+
+void write_all(int fd, const char *data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t written = ::pwrite(fd, data, length, offset);
+        if (written <= 0) {
+            throw std::runtime_error("Failed to write document store");
+        }
+        data += written;
+        length -= written;
+        offset += written;
+    }
+}
+
+void read_all(int fd, char *data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t bytes = ::pread(fd, data, length, offset);
+        if (bytes <= 0) {
+            throw std::runtime_error("Failed to read document store");
+        }
+        data += bytes;
+        length -= bytes;
+        offset += bytes;
+    }
+}
+
+}  // namespace
+
+DocumentStore::DocumentStore(const std::string &directory)
+    : path((std::filesystem::path(directory) / FILENAME).string()) {
+    std::filesystem::create_directories(directory);
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create document store: " + path);
+    }
+}
+
+DocumentStore::~DocumentStore() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+/*
+ *   the blocks are compressed outside of the lock, with the fastest level,
+ *   the text is read far more often than it is written
+ */
+void DocumentStore::put(uint32_t doc_id, const std::string &text) {
+    std::vector<std::vector<Bytef>> compressed;
+    for (size_t offset = 0; offset < text.size(); offset += BLOCK_SIZE) {
+        size_t length = std::min(BLOCK_SIZE, text.size() - offset);
+        uLongf compressed_length = compressBound(length);
+        std::vector<Bytef> block(compressed_length);
+        if (compress2(block.data(), &compressed_length, reinterpret_cast<const Bytef *>(text.data() + offset), length,
+                      Z_BEST_SPEED) != Z_OK) {
+            throw std::runtime_error("Failed to compress document text");
+        }
+        block.resize(compressed_length);
+        compressed.push_back(std::move(block));
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (doc_id >= documents.size()) {
+        documents.resize(doc_id + 1);
+    }
+    release(documents[doc_id]);
+
+    std::vector<Block> blocks;
+    for (size_t i = 0; i < compressed.size(); ++i) {
+        uint32_t length = std::min(BLOCK_SIZE, text.size() - i * BLOCK_SIZE);
+        write_all(fd, reinterpret_cast<const char *>(compressed[i].data()), compressed[i].size(), file_size);
+        blocks.push_back({file_size, static_cast<uint32_t>(compressed[i].size()), length});
+        file_size += compressed[i].size();
+        live_bytes += compressed[i].size();
+        text_bytes += length;
+    }
+    documents[doc_id] = std::move(blocks);
+
+    /* shared blocks are counted once per document, so the live bytes can exceed the file */
+    if (file_size > live_bytes && file_size - live_bytes > std::max(live_bytes, MIN_COMPACT_BYTES)) {
+        compact();
+    }
+}
+
+void DocumentStore::copy(uint32_t from_doc_id, uint32_t to_doc_id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (from_doc_id >= documents.size()) {
+        return;
+    }
+    if (to_doc_id >= documents.size()) {
+        documents.resize(to_doc_id + 1);
+    }
+    release(documents[to_doc_id]);
+    documents[to_doc_id] = documents[from_doc_id];
+    for (auto &block : documents[to_doc_id]) {
+        live_bytes += block.compressed_length;
+        text_bytes += block.length;
+    }
+}
+
+/*
+ *   only the blocks overlapping the range are read and decompressed,
+ *   the file is read under the lock, the decompression happens outside of it
+ */
+std::string DocumentStore::read(uint32_t doc_id, size_t offset, size_t length) const {
+    std::vector<Block> blocks;
+    std::vector<std::vector<Bytef>> compressed;
+    size_t first_block = offset / BLOCK_SIZE;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (doc_id >= documents.size() || first_block >= documents[doc_id].size()) {
+            return "";
+        }
+        const auto &document = documents[doc_id];
+        size_t last_block = std::min(document.size(), (offset + length + BLOCK_SIZE - 1) / BLOCK_SIZE);
+        for (size_t i = first_block; i < last_block; ++i) {
+            std::vector<Bytef> data(document[i].compressed_length);
+            read_all(fd, reinterpret_cast<char *>(data.data()), data.size(), document[i].offset);
+            blocks.push_back(document[i]);
+            compressed.push_back(std::move(data));
+        }
+    }
+
+    std::string text;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        size_t previous = text.size();
+        text.resize(previous + blocks[i].length);
+        uLongf text_length = blocks[i].length;
+        if (uncompress(reinterpret_cast<Bytef *>(text.data() + previous), &text_length, compressed[i].data(),
+                       compressed[i].size()) != Z_OK ||
+            text_length != blocks[i].length) {
+            throw std::runtime_error("Corrupt block in document store: " + path);
+        }
+    }
+
+    size_t skip = offset - first_block * BLOCK_SIZE;
+    return text.size() > skip ? text.substr(skip, length) : "";
+}
+
+size_t DocumentStore::get_length(uint32_t doc_id) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (doc_id >= documents.size()) {
+        return 0;
+    }
+    size_t length = 0;
+    for (auto &block : documents[doc_id]) {
+        length += block.length;
+    }
+    return length;
+}
+
+uint64_t DocumentStore::get_text_bytes() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return text_bytes;
+}
+
+uint64_t DocumentStore::get_file_bytes() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return file_size;
+}
+
+void DocumentStore::release(const std::vector<Block> &blocks) {
+    for (auto &block : blocks) {
+        live_bytes -= block.compressed_length;
+        text_bytes -= block.length;
+    }
+}
+
+/*
+ *   copies the referenced blocks to a new file and replaces the old one,
+ *   blocks shared by several documents are copied once
+ */
+void DocumentStore::compact() {
+    std::string compact_path = path + ".tmp";
+    int compact_fd = ::open(compact_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (compact_fd < 0) {
+        Logger::warn(LogComponent::INDEX, "Failed to compact document store: ", path);
+        return;
+    }
+
+    std::unordered_map<uint64_t, uint64_t> moved;
+    std::vector<std::vector<Block>> compacted = documents;
+    uint64_t compact_size = 0;
+    uint64_t compact_live_bytes = 0;
+    try {
+        std::vector<char> data;
+        for (auto &document : compacted) {
+            for (auto &block : document) {
+                auto it = moved.find(block.offset);
+                if (it == moved.end()) {
+                    data.resize(block.compressed_length);
+                    read_all(fd, data.data(), data.size(), block.offset);
+                    write_all(compact_fd, data.data(), data.size(), compact_size);
+                    it = moved.emplace(block.offset, compact_size).first;
+                    compact_size += data.size();
+                }
+                block.offset = it->second;
+                compact_live_bytes += block.compressed_length;
+            }
+        }
+    } catch (std::exception &e) {
+        Logger::warn(LogComponent::INDEX, "Failed to compact document store: ", e.what());
+        ::close(compact_fd);
+        std::remove(compact_path.c_str());
+        return;
+    }
+
+    if (std::rename(compact_path.c_str(), path.c_str()) != 0) {
+        Logger::warn(LogComponent::INDEX, "Failed to replace document store: ", path);
+        ::close(compact_fd);
+        std::remove(compact_path.c_str());
+        return;
+    }
+
+    Logger::debug(LogComponent::INDEX, "Compacted document store from ", file_size / 1024, " KiB to ",
+                  compact_size / 1024, " KiB");
+    ::close(fd);
+    fd = compact_fd;
+    file_size = compact_size;
+    live_bytes = compact_live_bytes;
+    documents = std::move(compacted);
+}
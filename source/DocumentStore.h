@@ -0,0 +1,67 @@
+#ifndef _H_DOCUMENTSTORE
+#define _H_DOCUMENTSTORE
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ *   Block compressed store of the extracted text of every indexed document
+ *   The text of a document is split into blocks of BLOCK_SIZE bytes, every
+ *   block is zlib compressed on its own and appended to a single file.
+ *   The block table is kept in memory, so any range of a document can be read
+ *   by decompressing only the blocks covering it.
+ *   Replaced texts leave garbage in the file, the file is compacted once the
+ *   garbage outweighs the live blocks.
+ */
+class DocumentStore {
+   public:
+    static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+    /* the store is rebuilt with the index on every start */
+    explicit DocumentStore(const std::string &directory);
+    ~DocumentStore();
+
+    DocumentStore(const DocumentStore &) = delete;
+    DocumentStore &operator=(const DocumentStore &) = delete;
+
+    /* stores the text of the document, replacing a previous one */
+    void put(uint32_t doc_id, const std::string &text);
+    /* lets the document share the stored text of another document */
+    void copy(uint32_t from_doc_id, uint32_t to_doc_id);
+
+    /* reads up to length bytes of the document text starting at offset */
+    std::string read(uint32_t doc_id, size_t offset, size_t length) const;
+    size_t get_length(uint32_t doc_id) const;
+
+    /* uncompressed size of the live texts and size of the store file */
+    uint64_t get_text_bytes() const;
+    uint64_t get_file_bytes() const;
+
+   private:
+    struct Block {
+        uint64_t offset;
+        uint32_t compressed_length;
+        uint32_t length;
+    };
+
+    /* drops the blocks of the document from the live counters */
+    void release(const std::vector<Block> &blocks);
+    /* rewrites the file with the live blocks only */
+    void compact();
+
+    std::string path;
+    int fd = -1;
+    uint64_t file_size = 0;
+    /* compressed and uncompressed size of the blocks still referenced */
+    uint64_t live_bytes = 0;
+    uint64_t text_bytes = 0;
+
+    mutable std::mutex mtx;
+    /* blocks of every document, indexed by doc id */
+    std::vector<std::vector<Block>> documents;
+};
+
+#endif
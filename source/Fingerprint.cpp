@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "Fingerprint.h"
+
+/*
+ *   XXH64, see https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+ *   streaming variant, so files are hashed in chunks without loading them
+ */
+namespace {
+
+constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+uint64_t rotl(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+uint64_t read64(const unsigned char *p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t read32(const unsigned char *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+uint64_t merge_round(uint64_t acc, uint64_t value) {
+    acc ^= xxh_round(0, value);
+    return acc * PRIME1 + PRIME4;
+}
+
+class XXH64 {
+   public:
+    explicit XXH64(uint64_t seed)
+        : seed(seed), v{seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1} {}
+
+    void update(const unsigned char *p, size_t length) {
+        total_length += length;
+
+        /* fill up the buffered stripe first */
+        if (buffered > 0) {
+            size_t fill = std::min(length, buffer.size() - buffered);
+            std::memcpy(buffer.data() + buffered, p, fill);
+            buffered += fill;
+            p += fill;
+            length -= fill;
+            if (buffered < buffer.size()) {
+                return;
+            }
+            consume_stripe(buffer.data());
+            buffered = 0;
+        }
+
+        while (length >= buffer.size()) {
+            consume_stripe(p);
+            p += buffer.size();
+            length -= buffer.size();
+        }
+
+        std::memcpy(buffer.data(), p, length);
+        buffered = length;
+    }
+
+    uint64_t digest() const {
+        uint64_t acc;
+        if (total_length >= buffer.size()) {
+            acc = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+            for (uint64_t lane : v) {
+                acc = merge_round(acc, lane);
+            }
+        } else {
+            acc = seed + PRIME5;
+        }
+        acc += total_length;
+
+        const unsigned char *p = buffer.data();
+        size_t length = buffered;
+        while (length >= 8) {
+            acc ^= xxh_round(0, read64(p));
+            acc = rotl(acc, 27) * PRIME1 + PRIME4;
+            p += 8;
+            length -= 8;
+        }
+        if (length >= 4) {
+            acc ^= read32(p) * PRIME1;
+            acc = rotl(acc, 23) * PRIME2 + PRIME3;
+            p += 4;
+            length -= 4;
+        }
+        while (length > 0) {
+            acc ^= (*p) * PRIME5;
+            acc = rotl(acc, 11) * PRIME1;
+            ++p;
+            --length;
+        }
+
+        acc ^= acc >> 33;
+        acc *= PRIME2;
+        acc ^= acc >> 29;
+        acc *= PRIME3;
+        acc ^= acc >> 32;
+        return acc;
+    }
+
+   private:
+    void consume_stripe(const unsigned char *p) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            v[lane] = xxh_round(v[lane], read64(p + lane * 8));
+        }
+    }
+
+    uint64_t seed;
+    uint64_t v[4];
+    uint64_t total_length = 0;
+    std::array<unsigned char, 32> buffer{};
+    size_t buffered = 0;
+};
+
+}  // namespace
+
+Fingerprint Fingerprint::of_file(const std::string &filepath) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file for fingerprinting: " + filepath);
+    }
+
+    XXH64 hasher(0);
+    Fingerprint fingerprint;
+    std::array<char, 64 * 1024> chunk;
+    while (file) {
+        file.read(chunk.data(), chunk.size());
+        std::streamsize count = file.gcount();
+        if (count <= 0) {
+            break;
+        }
+        hasher.update(reinterpret_cast<const unsigned char *>(chunk.data()), static_cast<size_t>(count));
+        fingerprint.size += static_cast<uintmax_t>(count);
+    }
+    if (file.bad()) {
+        throw std::runtime_error("Failed to read file for fingerprinting: " + filepath);
+    }
+
+    fingerprint.hash = hasher.digest();
+    return fingerprint;
+}
+
+uint64_t Fingerprint::hash_bytes(const void *data, size_t length, uint64_t seed) {
+    XXH64 hasher(seed);
+    hasher.update(static_cast<const unsigned char *>(data), length);
+    return hasher.digest();
+}
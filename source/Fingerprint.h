@@ -0,0 +1,31 @@
+#ifndef _H_FINGERPRINT
+#define _H_FINGERPRINT
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ *   identifies the content of a file by its size and a 64 bit xxHash (XXH64)
+ *   of its bytes, two files with the same fingerprint are treated as identical
+ */
+struct Fingerprint {
+    uintmax_t size = 0;
+    uint64_t hash = 0;
+
+    bool operator==(const Fingerprint &other) const = default;
+
+    /* reads the whole file, throws if the file cant be read */
+    static Fingerprint of_file(const std::string &filepath);
+
+    /* XXH64 of a buffer, used for files and other keys */
+    static uint64_t hash_bytes(const void *data, size_t length, uint64_t seed = 0);
+};
+
+struct FingerprintHash {
+    size_t operator()(const Fingerprint &fingerprint) const {
+        return static_cast<size_t>(fingerprint.hash ^ (fingerprint.size * 0x9E3779B97F4A7C15ULL));
+    }
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "ImpactIndex.h"
+
+namespace {
+
+/*
+ *   the accumulators are scanned and cleared 16 at a time with the vector
+ *   extensions of gcc and clang, which compile to SSE, AVX or NEON
+ */
+typedef uint16_t AccumulatorVector __attribute__((vector_size(32)));
+typedef uint64_t WordVector __attribute__((vector_size(32)));
+constexpr size_t LANES = sizeof(AccumulatorVector) / sizeof(uint16_t);
+
+/* with at most this many distinct terms a 16 bit accumulator cant overflow */
+constexpr size_t MAX_QUERY_TERMS = UINT16_MAX / UINT8_MAX;
+
+bool any_nonzero(const AccumulatorVector &accumulators) {
+    WordVector words = reinterpret_cast<WordVector>(accumulators);
+    return (words[0] | words[1] | words[2] | words[3]) != 0;
+}
+
+}  // namespace
+
+ImpactIndex::ImpactIndex(std::vector<ImpactPosting> postings, size_t term_count, size_t document_count,
+                         double max_score)
+    : document_count(document_count), score_unit(std::log1p(std::max(max_score, 0.0)) / UINT8_MAX) {
+    std::sort(postings.begin(), postings.end(), [](const ImpactPosting &a, const ImpactPosting &b) {
+        if (a.term != b.term) {
+            return a.term < b.term;
+        }
+        if (a.impact != b.impact) {
+            return a.impact > b.impact;
+        }
+        return a.doc_id < b.doc_id;
+    });
+
+    term_blocks.resize(term_count + 1);
+    doc_ids.reserve(postings.size());
+    size_t i = 0;
+    for (uint32_t term = 0; term < term_count; ++term) {
+        term_blocks[term] = block_starts.size();
+        while (i < postings.size() && postings[i].term == term) {
+            uint8_t impact = postings[i].impact;
+            block_starts.push_back(doc_ids.size());
+            block_impacts.push_back(impact);
+            while (i < postings.size() && postings[i].term == term && postings[i].impact == impact) {
+                doc_ids.push_back(postings[i++].doc_id);
+            }
+        }
+    }
+    term_blocks[term_count] = block_starts.size();
+    block_starts.push_back(doc_ids.size());
+
+    if (i != postings.size()) {
+        throw std::logic_error("Impact posting of a term outside of the dictionary");
+    }
+}
+
+uint8_t ImpactIndex::quantize(double score, double max_score) {
+    if (score <= 0.0 || max_score <= 0.0) {
+        return 0;
+    }
+    long impact = std::lround(std::log1p(score) / std::log1p(max_score) * UINT8_MAX);
+    return static_cast<uint8_t>(std::clamp<long>(impact, 1, UINT8_MAX));
+}
+
+/*
+ *   the accumulators of a thread stay allocated between queries, the scan
+ *   for the result clears them again, only the range of touched documents is scanned
+ */
+std::vector<std::pair<uint32_t, double>> ImpactIndex::query(const std::vector<uint32_t> &terms, size_t budget) const {
+    std::vector<uint32_t> unique_terms(terms);
+    std::sort(unique_terms.begin(), unique_terms.end());
+    unique_terms.erase(std::unique(unique_terms.begin(), unique_terms.end()), unique_terms.end());
+    if (unique_terms.size() > MAX_QUERY_TERMS) {
+        unique_terms.resize(MAX_QUERY_TERMS);
+    }
+
+    /* score at a time, the blocks of all terms by descending impact */
+    std::vector<uint32_t> blocks;
+    for (uint32_t term : unique_terms) {
+        if (term + 1 >= term_blocks.size()) {
+            continue;
+        }
+        for (uint32_t block = term_blocks[term]; block < term_blocks[term + 1]; ++block) {
+            blocks.push_back(block);
+        }
+    }
+    std::stable_sort(blocks.begin(), blocks.end(),
+                     [this](uint32_t a, uint32_t b) { return block_impacts[a] > block_impacts[b]; });
+
+    thread_local std::vector<uint16_t> accumulators;
+    size_t padded = (document_count + LANES - 1) / LANES * LANES;
+    if (accumulators.size() < padded) {
+        accumulators.resize(padded);
+    }
+
+    uint32_t low = UINT32_MAX;
+    uint32_t high = 0;
+    size_t scored = 0;
+    queries++;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        uint32_t block = blocks[i];
+        uint16_t impact = block_impacts[block];
+        uint32_t begin = block_starts[block];
+        uint32_t end = block_starts[block + 1];
+        for (uint32_t p = begin; p < end; ++p) {
+            accumulators[doc_ids[p]] += impact;
+        }
+        /* the postings of a block are ordered by doc id */
+        low = std::min(low, doc_ids[begin]);
+        high = std::max(high, doc_ids[end - 1]);
+        scored += end - begin;
+
+        if (budget > 0 && scored >= budget) {
+            if (i + 1 < blocks.size()) {
+                early_terminations++;
+            }
+            break;
+        }
+    }
+    postings_scored += scored;
+
+    std::vector<std::pair<uint32_t, double>> result;
+    if (scored == 0) {
+        return result;
+    }
+    AccumulatorVector zero = {};
+    for (size_t chunk = low / LANES * LANES; chunk <= high; chunk += LANES) {
+        AccumulatorVector values;
+        std::memcpy(&values, accumulators.data() + chunk, sizeof(values));
+        if (!any_nonzero(values)) {
+            continue;
+        }
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            if (values[lane] != 0) {
+                result.emplace_back(static_cast<uint32_t>(chunk + lane), values[lane] * score_unit);
+            }
+        }
+        std::memcpy(accumulators.data() + chunk, &zero, sizeof(zero));
+    }
+    return result;
+}
+
+ImpactIndex::Statistics ImpactIndex::get_statistics() const {
+    Statistics statistics{};
+    statistics.postings = doc_ids.size();
+    statistics.blocks = block_impacts.size();
+    statistics.bytes = (term_blocks.size() + block_starts.size() + doc_ids.size()) * sizeof(uint32_t) +
+                       block_impacts.size();
+    statistics.queries = queries;
+    statistics.early_terminations = early_terminations;
+    statistics.average_postings_scored =
+        statistics.queries == 0 ? 0.0 : static_cast<double>(postings_scored) / statistics.queries;
+    return statistics;
+}
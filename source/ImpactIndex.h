@@ -0,0 +1,69 @@
+#ifndef _H_IMPACTINDEX
+#define _H_IMPACTINDEX
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* the quantized score of a term in a document, input of the build */
+struct ImpactPosting {
+    uint32_t term;
+    uint32_t doc_id;
+    uint8_t impact;
+};
+
+/*
+ *   Impact ordered inverted index
+ *   The tfidf score of every posting is precomputed and quantized to 8 bits on
+ *   a log scale, so a few very high scores dont squash all others into one level,
+ *   the postings of a term are grouped into blocks of equal impact, ordered by
+ *   descending impact. Terms are identified by their position in the term dictionary.
+ *   Queries are evaluated score at a time: the blocks of all query terms are
+ *   processed by descending impact into a dense accumulator per document, so
+ *   the most important postings are scored first and the evaluation can stop
+ *   after a budget of postings with a good approximation of the ranking.
+ */
+class ImpactIndex {
+   public:
+    /* the postings are consumed, term_count is the size of the dictionary */
+    ImpactIndex(std::vector<ImpactPosting> postings, size_t term_count, size_t document_count, double max_score);
+
+    /* maps log(1 + score) to 1..255, relative to the highest score of the index */
+    static uint8_t quantize(double score, double max_score);
+
+    /*
+     *   documents with their score, unordered, for the given dictionary terms,
+     *   a budget > 0 stops after the block in which budget postings were reached
+     */
+    std::vector<std::pair<uint32_t, double>> query(const std::vector<uint32_t> &terms, size_t budget) const;
+
+    struct Statistics {
+        uint64_t postings;
+        uint64_t blocks;
+        uint64_t bytes;
+        uint64_t queries;
+        /* queries stopped by the budget before all postings were scored */
+        uint64_t early_terminations;
+        double average_postings_scored;
+    };
+    Statistics get_statistics() const;
+
+   private:
+    size_t document_count;
+    /* log(1 + score) of impact 1, query scores are impact sums times this */
+    double score_unit;
+
+    /* blocks of term t are term_blocks[t] to term_blocks[t + 1] */
+    std::vector<uint32_t> term_blocks;
+    /* postings of block b are doc_ids[block_starts[b]] to doc_ids[block_starts[b + 1]] */
+    std::vector<uint32_t> block_starts;
+    std::vector<uint8_t> block_impacts;
+    std::vector<uint32_t> doc_ids;
+
+    mutable std::atomic<uint64_t> queries{0};
+    mutable std::atomic<uint64_t> early_terminations{0};
+    mutable std::atomic<uint64_t> postings_scored{0};
+};
+
+#endif
@@ -1,54 +1,134 @@
-#include <iostream>
+#include <cctype>
 #include <filesystem>
 #include <fstream>
 #include <cmath>
+#include <unordered_set>
 
 #include "Index.h"
 #include "DocumentFactory.h"
+#include "Logger.h"
+
+namespace {
+
+/* bytes of text shown before the first matched term and in total in a snippet */
+constexpr size_t SNIPPET_CONTEXT = 80;
+constexpr size_t SNIPPET_LENGTH = 320;
+
+/* terms a query term without hits is expanded to */
+constexpr size_t FUZZY_EXPANSIONS = 3;
+
+/* with segments, documents indexed per thread before their postings are buffered */
+constexpr size_t SEGMENT_SLICE_PER_THREAD = 8;
+
+/* slices of the documents per thread when a query batch looks up its terms in memory */
+constexpr size_t BATCH_SLICE_PER_THREAD = 4;
+
+}  // namespace
 
 /*
  *  The directory is the directory which is read and indexed, the index_path is
  *  TODO: save index to filesystem, json?
  */
-Index::Index(std::string directory, std::string index_path, int threads_used)
-    : index_path(index_path), thread_num(threads_used) {
+Index::Index(std::string directory, std::string index_path, int threads_used, IndexConfig config)
+    : index_path(index_path), config(config) {
 
     const auto processor_count = std::thread::hardware_concurrency();
     if (processor_count == 0) {
-        std::cerr << "Processor count cant be determined" << std::endl;
+        Logger::warn(LogComponent::INDEX, "Processor count cant be determined");
+    }
+    Logger::info(LogComponent::INDEX, "Processor count: ", processor_count, " used threads: ", threads_used);
+    pool = std::make_unique<ThreadPool>(std::max(threads_used, 1));
+
+    if (config.text_cache_bytes > 0) {
+        try {
+            text_cache = std::make_unique<TextCache>(
+                (std::filesystem::path(index_path) / "text-cache").string(), config.text_cache_bytes);
+        } catch (std::exception &e) {
+            Logger::error(LogComponent::INDEX, "Text cache disabled: ", e.what());
+        }
+    }
+
+    if (config.store_documents) {
+        try {
+            document_store = std::make_unique<DocumentStore>((std::filesystem::path(index_path) / "documents").string());
+        } catch (std::exception &e) {
+            Logger::error(LogComponent::INDEX, "Document store disabled: ", e.what());
+        }
+    }
+
+    if (config.max_build_memory > 0) {
+        segments = std::make_unique<SegmentIndex>(
+            (std::filesystem::path(index_path) / "segments").string(), config.max_build_memory,
+            config.merge_factor, config.merge_bytes_per_second);
+        Logger::info(LogComponent::INDEX, "Building segments with a memory budget of ",
+                     config.max_build_memory / 1024 / 1024, " MiB");
     }
-    std::cout << "Processor count: " << processor_count << " used threads: " << threads_used << std::endl;
 
     /* start building the index */
     try {
         read_stopwords("stopwords.txt");
         build_document_index(directory);
-        build_tfidf_index();
+        if (segments) {
+            segments->flush();
+            build_dictionary();
+        } else {
+            build_dictionary();
+            if (config.layout == IndexLayout::IMPACT) {
+                build_impact_index();
+            } else {
+                build_tfidf_index();
+            }
+        }
     } catch (std::exception &e) {
-        std::cerr << "Caught Exception building index: " << e.what() << std::endl;
+        Logger::error(LogComponent::INDEX, "Caught Exception building index: ", e.what());
     }
 
     /* statistics */
-    std::cout << "Documents: " << get_document_counter() << std::endl;
+    Logger::info(LogComponent::INDEX, "Documents: ", get_document_counter(),
+                 " unique: ", get_unique_document_counter());
+    if (text_cache) {
+        Logger::info(LogComponent::INDEX, "Text cache hits: ", text_cache->get_hits(),
+                     " misses: ", text_cache->get_misses());
+    }
 }
 
 /*
  *  queries the index and returns the result ordered by tfidf ranking
- *  returns a sorted vector of pairs <filepath, rank>
+ *  the rank of a document is the sum of the scores of all input values
+ *  returns a sorted vector of results, duplicates are listed as aliases
  */
-std::vector<std::pair<std::string, double>> Index::queryIndex(
+std::vector<SearchResult> Index::queryIndex(
     const std::vector<std::string> &input_values) {
-    std::vector<std::pair<std::string, double>> result;
+    if (segments) {
+        return query_segments(input_values);
+    }
+    if (impacts) {
+        return query_impacts(input_values);
+    }
+
+    std::vector<SearchResult> result;
     /* loop over every document in the index */
     for (auto &document : documents) {
+        /* aliases have no postings, they are reported with their canonical document */
+        if (document->is_alias()) {
+            continue;
+        }
+
         double rank = 0.0;
+        std::vector<uint32_t> term_offsets;
         for (auto &input : input_values) {
             try {
-                rank = document->get_tfidf_score(input);
+                double score = document->get_tfidf_score(input);
+                if (score == 0.0) {
+                    continue;
+                }
+                rank += score;
+                if (const TermOccurrence *occurrence = document->get_occurrence(input)) {
+                    term_offsets.push_back(occurrence->first_offset);
+                }
             } catch (std::exception &e) {
-                std::cerr << "Error getting tfidf rank of term: " << input;
-                std::cerr << " in Document: " << document->get_filepath();
-				std::cerr << " " << e.what() << std::endl;
+                Logger::error(LogComponent::INDEX, "Error getting tfidf rank of term: ", input,
+                              " in Document: ", document->get_filepath(), " ", e.what());
             }
         }
 
@@ -56,117 +136,639 @@ std::vector<std::pair<std::string, double>> Index::queryIndex(
             continue;
         }
 
-        result.push_back(std::make_pair(document->get_filepath(), rank));
+        result.push_back(make_result(*document, rank));
+        result.back().term_offsets = std::move(term_offsets);
     }
 
     /* Sort the result ascending by rank */
     std::sort(result.begin(), result.end(),
-        [](const auto &a, const auto &b) { return a.second > b.second; });
+        [](const auto &a, const auto &b) { return a.score > b.score; });
+
+    return result;
+}
+
+/*
+ *  with segments the tfidf is calculated at query time, from the term frequency
+ *  in the postings and the number of postings of the term
+ */
+std::vector<SearchResult> Index::query_segments(const std::vector<std::string> &input_values) {
+    struct Match {
+        double rank = 0.0;
+        std::vector<uint32_t> term_offsets;
+    };
+    std::unordered_map<uint32_t, Match> matches;
+    double n = get_unique_document_counter();
+
+    for (auto &input : input_values) {
+        std::vector<Posting> postings = segments->find(input);
+        if (postings.empty()) {
+            continue;
+        }
+        double idf = std::log10(n / postings.size());
+        for (auto &posting : postings) {
+            Match &match = matches[posting.doc_id];
+            match.rank += posting.term_frequency * idf;
+            match.term_offsets.push_back(posting.first_offset);
+        }
+    }
+
+    std::vector<SearchResult> result;
+    for (auto &[doc_id, match] : matches) {
+        if (match.rank == 0.0) {
+            continue;
+        }
+        result.push_back(make_result(*documents.at(doc_id), match.rank));
+        result.back().term_offsets = std::move(match.term_offsets);
+    }
+
+    std::sort(result.begin(), result.end(),
+        [](const auto &a, const auto &b) { return a.score > b.score; });
+
+    return result;
+}
+
+/*
+ *  with the impact layout only the quantized scores of the query terms are added up,
+ *  terms which are not in the dictionary have no postings
+ */
+std::vector<SearchResult> Index::query_impacts(const std::vector<std::string> &input_values) {
+    std::vector<uint32_t> terms;
+    for (auto &input : input_values) {
+        if (std::optional<uint32_t> ordinal = dictionary->find(input)) {
+            terms.push_back(*ordinal);
+        }
+    }
+
+    std::vector<SearchResult> result;
+    for (auto &[doc_id, score] : impacts->query(terms, config.impact_budget)) {
+        result.push_back(make_result(*documents.at(doc_id), score));
+    }
+
+    std::sort(result.begin(), result.end(),
+        [](const auto &a, const auto &b) { return a.score > b.score; });
 
     return result;
 }
 
+/*
+ *  the terms of all queries are deduplicated and their postings fetched once,
+ *  then every query only adds up the postings of its terms, one task per query
+ */
+std::vector<std::vector<SearchResult>> Index::query_batch(const std::vector<std::vector<std::string>> &queries,
+                                                          size_t limit) {
+    std::vector<std::string> terms;
+    for (auto &query : queries) {
+        terms.insert(terms.end(), query.begin(), query.end());
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+    /* a query as positions in terms, repeated terms count repeatedly like in queryIndex */
+    std::vector<std::vector<size_t>> query_terms(queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        for (auto &input : queries[i]) {
+            query_terms[i].push_back(std::lower_bound(terms.begin(), terms.end(), input) - terms.begin());
+        }
+    }
+
+    std::vector<std::vector<SearchResult>> results(queries.size());
+    auto rank = [&](size_t i, std::vector<SearchResult> &result) {
+        /* ties are ordered by doc id, so repeated batches return the same results */
+        std::sort(result.begin(), result.end(), [](const auto &a, const auto &b) {
+            return a.score > b.score || (a.score == b.score && a.doc_id < b.doc_id);
+        });
+        if (result.size() > limit) {
+            result.resize(limit);
+        }
+        results[i] = std::move(result);
+    };
+
+    /* the impact postings are uncompressed already, only the dictionary lookups are shared */
+    if (impacts) {
+        std::vector<std::optional<uint32_t>> ordinals(terms.size());
+        for (size_t t = 0; t < terms.size(); ++t) {
+            ordinals[t] = dictionary->find(terms[t]);
+        }
+        pool->parallel_for(0, queries.size(), 1, [&](size_t i) {
+            std::vector<uint32_t> ordinal_terms;
+            for (size_t t : query_terms[i]) {
+                if (ordinals[t]) {
+                    ordinal_terms.push_back(*ordinals[t]);
+                }
+            }
+            std::vector<SearchResult> result;
+            for (auto &[doc_id, score] : impacts->query(ordinal_terms, config.impact_budget)) {
+                result.push_back(make_result(*documents.at(doc_id), score));
+            }
+            rank(i, result);
+        });
+        return results;
+    }
+
+    std::vector<std::vector<std::pair<uint32_t, double>>> postings = fetch_postings(terms);
+    pool->parallel_for(0, queries.size(), 1, [&](size_t i) {
+        std::unordered_map<uint32_t, double> ranks;
+        for (size_t t : query_terms[i]) {
+            for (auto &[doc_id, score] : postings[t]) {
+                ranks[doc_id] += score;
+            }
+        }
+        std::vector<SearchResult> result;
+        for (auto &[doc_id, score] : ranks) {
+            if (score != 0.0) {
+                result.push_back(make_result(*documents.at(doc_id), score));
+            }
+        }
+        rank(i, result);
+    });
+    return results;
+}
+
+/*
+ *  with segments every term is read from the segments once, in memory the documents
+ *  are traversed once in slices on the thread pool, looking up all terms per document
+ */
+std::vector<std::vector<std::pair<uint32_t, double>>> Index::fetch_postings(const std::vector<std::string> &terms) {
+    std::vector<std::vector<std::pair<uint32_t, double>>> postings(terms.size());
+    if (terms.empty()) {
+        return postings;
+    }
+
+    if (segments) {
+        double n = get_unique_document_counter();
+        pool->parallel_for(0, terms.size(), 1, [&](size_t t) {
+            std::vector<Posting> found = segments->find(terms[t]);
+            if (found.empty()) {
+                return;
+            }
+            double idf = std::log10(n / found.size());
+            for (auto &posting : found) {
+                postings[t].emplace_back(posting.doc_id, posting.term_frequency * idf);
+            }
+        });
+        return postings;
+    }
+
+    size_t slice_count = std::min(documents.size(), pool->get_thread_count() * BATCH_SLICE_PER_THREAD);
+    std::vector<std::vector<std::vector<std::pair<uint32_t, double>>>> slices(slice_count);
+    pool->parallel_for(0, slice_count, 1, [&](size_t s) {
+        slices[s].resize(terms.size());
+        size_t begin = documents.size() * s / slice_count;
+        size_t end = documents.size() * (s + 1) / slice_count;
+        for (size_t i = begin; i < end; ++i) {
+            /* aliases have no postings, they are reported with their canonical document */
+            if (documents[i]->is_alias()) {
+                continue;
+            }
+            for (size_t t = 0; t < terms.size(); ++t) {
+                double score = documents[i]->get_tfidf_score(terms[t]);
+                if (score != 0.0) {
+                    slices[s][t].emplace_back(documents[i]->get_id(), score);
+                }
+            }
+        }
+    });
+
+    /* appending the slices in order keeps the postings sorted by doc id */
+    for (auto &slice : slices) {
+        for (size_t t = 0; t < terms.size(); ++t) {
+            postings[t].insert(postings[t].end(), slice[t].begin(), slice[t].end());
+        }
+    }
+    return postings;
+}
+
+SearchResult Index::make_result(const Document &document, double rank) {
+    std::vector<std::string> aliases;
+    for (auto *alias : document.get_aliases()) {
+        aliases.push_back(alias->get_filepath());
+    }
+    SearchResult result;
+    result.filepath = document.get_filepath();
+    result.score = rank;
+    result.aliases = std::move(aliases);
+    result.doc_id = document.get_id();
+    return result;
+}
+
+void Index::add_snippets(std::vector<SearchResult> &results, const std::vector<std::string> &input_values,
+                         size_t count) {
+    if (!document_store) {
+        return;
+    }
+    for (size_t i = 0; i < std::min(count, results.size()); ++i) {
+        /* the impact layout keeps no positions, they are still in the concordance */
+        if (results[i].term_offsets.empty() && !segments) {
+            const Document &document = *documents.at(results[i].doc_id);
+            for (auto &input : input_values) {
+                if (const TermOccurrence *occurrence = document.get_occurrence(input)) {
+                    results[i].term_offsets.push_back(occurrence->first_offset);
+                }
+            }
+        }
+        try {
+            results[i].snippet = make_snippet(results[i], input_values);
+        } catch (std::exception &e) {
+            Logger::warn(LogComponent::INDEX, "Failed to create snippet of ", results[i].filepath, ": ", e.what());
+        }
+    }
+}
+
+/*
+ *   reads a window of the stored text around the earliest matched term, only the
+ *   blocks of the window are decompressed, the window is cut at whitespace and
+ *   words are matched the same way clean_word splits them
+ */
+Snippet Index::make_snippet(const SearchResult &result, const std::vector<std::string> &input_values) {
+    uint32_t anchor = result.term_offsets.empty()
+                          ? 0
+                          : *std::min_element(result.term_offsets.begin(), result.term_offsets.end());
+    size_t start = anchor > SNIPPET_CONTEXT ? anchor - SNIPPET_CONTEXT : 0;
+    std::string window = document_store->read(result.doc_id, start, SNIPPET_LENGTH);
+
+    Snippet snippet;
+    size_t begin = 0;
+    size_t end = window.size();
+    snippet.truncated_front = start > 0;
+    snippet.truncated_back = start + window.size() < document_store->get_length(result.doc_id);
+    auto is_space = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+    if (snippet.truncated_front) {
+        while (begin < end && !is_space(window[begin])) {
+            ++begin;
+        }
+    }
+    if (snippet.truncated_back) {
+        while (end > begin && !is_space(window[end - 1])) {
+            --end;
+        }
+    }
+
+    /* collapse whitespace, the text comes from pdfs and xml as well */
+    for (size_t i = begin; i < end; ++i) {
+        if (!is_space(window[i])) {
+            snippet.text.push_back(window[i]);
+        } else if (!snippet.text.empty() && snippet.text.back() != ' ') {
+            snippet.text.push_back(' ');
+        }
+    }
+    if (!snippet.text.empty() && snippet.text.back() == ' ') {
+        snippet.text.pop_back();
+    }
+
+    std::unordered_set<std::string_view> terms(input_values.begin(), input_values.end());
+    auto is_word = [](char c) {
+        unsigned char u = static_cast<unsigned char>(c);
+        return !(std::ispunct(u) || std::isdigit(u) || std::isspace(u));
+    };
+    std::string word;
+    for (size_t pos = 0; pos < snippet.text.size();) {
+        if (!is_word(snippet.text[pos])) {
+            ++pos;
+            continue;
+        }
+        size_t word_end = pos;
+        word.clear();
+        while (word_end < snippet.text.size() && is_word(snippet.text[word_end])) {
+            word.push_back(std::tolower(static_cast<unsigned char>(snippet.text[word_end])));
+            ++word_end;
+        }
+        if (terms.contains(word)) {
+            snippet.highlights.emplace_back(pos, word_end - pos);
+        }
+        pos = word_end;
+    }
+    return snippet;
+}
+
 /*
  * returns the number of documents in the index
  */
 int Index::get_document_counter() { return documents.size(); }
 
+/*
+ * returns the number of distinct contents in the index, duplicates count once
+ */
+int Index::get_unique_document_counter() { return canonical_documents.size(); }
+
+IndexStatistics Index::get_statistics() {
+    IndexStatistics statistics{};
+    statistics.documents = get_document_counter();
+    statistics.unique_documents = get_unique_document_counter();
+    statistics.segmented = segments != nullptr;
+    if (segments) {
+        statistics.segments = segments->get_statistics();
+    }
+    if (document_store) {
+        statistics.stored_text_bytes = document_store->get_text_bytes();
+        statistics.stored_file_bytes = document_store->get_file_bytes();
+    }
+    if (auto current = get_dictionary()) {
+        statistics.dictionary_terms = current->get_term_count();
+        statistics.dictionary_states = current->get_state_count();
+        statistics.dictionary_bytes = current->get_memory_bytes();
+    }
+    statistics.thread_pool = pool->get_statistics();
+    statistics.impact_layout = impacts != nullptr;
+    if (impacts) {
+        statistics.impacts = impacts->get_statistics();
+    }
+    return statistics;
+}
+
 /*
  *   Moves trough a directy and try's to read every supported file in it
  *   For every supported file in the dir, a Document is created
+ *   the files are hashed and indexed on the thread pool, duplicates are
+ *   detected in between in directory order
  */
 void Index::build_document_index(std::string directory) {
     /* if the param is a directory */
     if (std::filesystem::status(directory).type() == std::filesystem::file_type::directory) {
-        std::cout << "Building index of directory: " << directory << std::endl;
+        Logger::info(LogComponent::INDEX, "Building index of directory: ", directory);
+        std::vector<std::unique_ptr<Document>> created;
         if (std::filesystem::exists(directory)) {
             for (auto const &entry : std::filesystem::recursive_directory_iterator(directory)) {
                 std::string filepath = entry.path();
                 std::string file_extension = std::filesystem::path(entry.path()).extension();
 
                 try {
-                    std::unique_ptr<Document> new_doc = DocumentFactory::create_document(filepath, file_extension);
-                    new_doc->index_document();
-                    documents.push_back(std::move(new_doc));
+                    created.push_back(DocumentFactory::create_document(filepath, file_extension, text_cache.get()));
                 } catch (std::exception &e) {
-                    std::cerr << "Exception caught reading file: ";
-					std::cerr << e.what() << std::endl;
+                    Logger::error(LogComponent::INDEX, "Exception caught reading file: ", e.what());
                 }
             }
         }
+
+        std::vector<char> readable(created.size(), 0);
+        pool->parallel_for(0, created.size(), 1, [&](size_t i) {
+            try {
+                created[i]->refresh_fingerprint();
+                readable[i] = 1;
+            } catch (std::exception &e) {
+                Logger::error(LogComponent::INDEX, "Exception caught reading file: ", e.what());
+            }
+        });
+
+        std::vector<Document *> batch;
+        for (size_t i = 0; i < created.size(); ++i) {
+            if (!readable[i]) {
+                continue;
+            }
+            created[i]->set_id(documents.size());
+            if (assign_document(created[i].get())) {
+                batch.push_back(created[i].get());
+            }
+            documents.push_back(std::move(created[i]));
+        }
+        index_documents(batch);
     } else {
-        std::cerr << "No directoy given to index" << std::endl;
+        Logger::error(LogComponent::INDEX, "No directoy given to index");
         throw std::runtime_error("Directory to index not found: " + directory);
     }
 }
 
 /*
- * Uses threads to read every file in the document index
- * and calculate its tfidf score per every word in the doucments
+ * the tfidf scores are calculated per document on the thread pool, quantized on
+ * a log scale against the highest score of the index and grouped by term, the documents
+ * keep their concordances for reindexing and snippets but no scores
  */
-void Index::build_tfidf_index() {
-    std::cout << "Running build tfidf index" << std::endl;
+void Index::build_impact_index() {
+    Logger::info(LogComponent::INDEX, "Running build impact index");
     const auto start{std::chrono::steady_clock::now()};
 
-    int files_per_thread = get_document_counter() / thread_num;
-    for (int i = 0; i < thread_num; ++i) {
-        int start_index = i * files_per_thread;
-        int end_index = (i == thread_num) ? get_document_counter(): (i + 1) * files_per_thread;
-        threads.emplace_back([this, start_index, end_index]() {
-            this->calculate_tfidf_index(start_index, end_index);
-        });
+    std::vector<std::vector<std::pair<uint32_t, double>>> scores(documents.size());
+    pool->parallel_for(0, documents.size(), 1, [&](size_t i) {
+        for (auto &term : documents[i]->get_concordance()) {
+            if (is_stopword(term.first)) {
+                continue;
+            }
+            std::optional<uint32_t> ordinal = dictionary->find(term.first);
+            if (!ordinal) {
+                continue;
+            }
+            double score = term.second.count * inverse_doc_frequency(term.first);
+            if (score > 0.0) {
+                scores[i].emplace_back(*ordinal, score);
+            }
+        }
+    });
+
+    double max_score = 0.0;
+    size_t posting_count = 0;
+    for (auto &document_scores : scores) {
+        for (auto &[ordinal, score] : document_scores) {
+            max_score = std::max(max_score, score);
+        }
+        posting_count += document_scores.size();
     }
 
-    for (std::thread &thread : threads) {
-        thread.join();
+    std::vector<ImpactPosting> postings;
+    postings.reserve(posting_count);
+    for (size_t i = 0; i < scores.size(); ++i) {
+        for (auto &[ordinal, score] : scores[i]) {
+            postings.push_back({ordinal, static_cast<uint32_t>(i), ImpactIndex::quantize(score, max_score)});
+        }
+        scores[i] = {};
     }
+    impacts = std::make_unique<ImpactIndex>(std::move(postings), dictionary->get_term_count(), documents.size(),
+                                            max_score);
+
+    const std::chrono::duration<double> elapsed_seconds{std::chrono::steady_clock::now() - start};
+    ImpactIndex::Statistics statistics = impacts->get_statistics();
+    Logger::info(LogComponent::INDEX, "Building impact index took: ", elapsed_seconds.count(), " seconds, ",
+                 statistics.postings, " postings in ", statistics.blocks, " blocks, ", statistics.bytes / 1024, " KiB");
+}
+
+/*
+ * calculates the tfidf score of every word in the documents on the thread pool,
+ * one task per document, so a few large documents dont hold up the build
+ */
+void Index::build_tfidf_index() {
+    Logger::info(LogComponent::INDEX, "Running build tfidf index");
+    const auto start{std::chrono::steady_clock::now()};
+
+    pool->parallel_for(0, documents.size(), 1, [this](size_t i) { calculate_tfidf_scores(*documents[i]); });
 
     const auto end{std::chrono::steady_clock::now()};
     const std::chrono::duration<double> elapsed_seconds{end - start};
-    std::cout << "Building tfidf index took: " << elapsed_seconds.count() << "seconds" << std::endl;
+    ThreadPool::Statistics statistics = pool->get_statistics();
+    Logger::info(LogComponent::INDEX, "Building tfidf index took: ", elapsed_seconds.count(), "seconds");
+    Logger::debug(LogComponent::INDEX, "Thread pool: ", statistics.tasks, " tasks, ", statistics.steals,
+                  " steals, utilization ", statistics.utilization);
+}
+
+/*
+ * calculates the tfidf for every word of the document and saves the
+ * values per word in its hashmap
+ * To be run the build document index and the dictionary have to be complete
+ */
+void Index::calculate_tfidf_scores(Document &document) {
+    /* the scores of the previous build are released in one go */
+    document.reset_tfidf_scores();
+    for (auto &term : document.get_concordance()) {
+        std::string_view term_view = term.first;
+        /* skip stop words */
+        if (is_stopword(term_view)) {
+            continue;
+        }
+        /* caclulating the tfidf */
+        double tfidf = term.second.count * inverse_doc_frequency(term_view);
+        document.insert_tfidf_score(term_view, tfidf);
+    }
+}
+
+/*
+ * Calculates the idf for a certain term over the whole index,
+ * the document frequency comes from the dictionary, duplicates count once
+ */
+double Index::inverse_doc_frequency(std::string_view term) {
+    uint32_t term_count = dictionary ? dictionary->document_frequency(term) : 0;
+    if (term_count == 0) {
+        return 0.0;
+    }
+
+    return std::log10((double)get_unique_document_counter() / (double)term_count);
 }
 
 /*
- * calculates the tfidf for every word of every document in the
- * document index, saves the calculated values per word in a hashmap,
- * the values are accessed by filepath,
- * needs the start and end index because of threads
- * the tfidf index itself is protected by a mutex
- * To be run the build document index has to be complete
+ * collects the document frequency of every term of the canonical documents,
+ * with segments from the live postings, and builds a new dictionary from them
  */
-void Index::calculate_tfidf_index(int start_index, int end_index) {
-    for (int i = start_index; i < end_index; ++i) {
-        for (auto &term : documents.at(i)->get_concordance()) {
-            /* skip stop words */
-            if (std::find(stopwords.begin(), stopwords.end(), term.first) !=
-                stopwords.end()) {
+void Index::build_dictionary() {
+    const auto start{std::chrono::steady_clock::now()};
+    TermDictionary::Builder builder;
+
+    if (segments) {
+        segments->for_each_term([&builder](std::string_view term, uint32_t document_frequency) {
+            builder.add(term, document_frequency);
+        });
+    } else {
+        TermTable<uint32_t> document_frequencies;
+        for (auto &document : documents) {
+            if (document->is_alias()) {
                 continue;
             }
-            /* caclulating the tfidf */
-            double tfidf = documents.at(i)->get_term_frequency(term.first) * inverse_doc_frequency(term.first, documents);
-            documents.at(i)->insert_tfidf_score({term.first, tfidf});
+            for (auto &term : document->get_concordance()) {
+                if (is_stopword(term.first)) {
+                    continue;
+                }
+                auto it = document_frequencies.terms.find(std::string_view(term.first));
+                if (it != document_frequencies.terms.end()) {
+                    it->second++;
+                } else {
+                    document_frequencies.terms.emplace(term.first, 1);
+                }
+            }
+        }
+
+        std::vector<const std::pair<const std::pmr::string, uint32_t> *> sorted;
+        sorted.reserve(document_frequencies.terms.size());
+        for (auto &entry : document_frequencies.terms) {
+            sorted.push_back(&entry);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const auto *a, const auto *b) { return a->first < b->first; });
+        for (auto *entry : sorted) {
+            builder.add(entry->first, entry->second);
         }
     }
+
+    auto built = std::make_shared<const TermDictionary>(builder.finish());
+    {
+        std::lock_guard<std::mutex> lock(dictionary_mtx);
+        dictionary = built;
+    }
+
+    const std::chrono::duration<double> elapsed_seconds{std::chrono::steady_clock::now() - start};
+    Logger::info(LogComponent::INDEX, "Term dictionary: ", built->get_term_count(), " terms, ",
+                 built->get_state_count(), " states, ", built->get_memory_bytes() / 1024,
+                 " KiB, took ", elapsed_seconds.count(), " seconds");
 }
 
 /*
- * Calculates the idf for a certain term over the whole index
+ * with segments a reindex only writes the changed documents, the dictionary needs
+ * a walk over all live segments, so it is rebuilt on the thread pool instead of the
+ * reindex path, changes during a build make it run once more when it is done
  */
-double Index::inverse_doc_frequency(std::string term, const std::vector<std::unique_ptr<Document>> &corpus) {
-    int term_count = 0;
-    int n = corpus.size();
-
-    for (auto &doc : corpus) {
-        if (doc->contains_term(term)) {
-            term_count++;
+void Index::schedule_dictionary_build() {
+    {
+        std::lock_guard<std::mutex> lock(dictionary_mtx);
+        if (dictionary_building) {
+            dictionary_stale = true;
+            return;
         }
+        dictionary_building = true;
     }
 
-    if (term_count == 0) {
-        return 0.0;
+    pool->submit([this]() {
+        while (true) {
+            try {
+                build_dictionary();
+            } catch (std::exception &e) {
+                Logger::error(LogComponent::INDEX, "Caught Exception building the term dictionary: ", e.what());
+            }
+            std::lock_guard<std::mutex> lock(dictionary_mtx);
+            if (!dictionary_stale) {
+                dictionary_building = false;
+                return;
+            }
+            dictionary_stale = false;
+        }
+    });
+}
+
+std::shared_ptr<const TermDictionary> Index::get_dictionary() {
+    std::lock_guard<std::mutex> lock(dictionary_mtx);
+    return dictionary;
+}
+
+std::vector<DictionaryEntry> Index::suggest(std::string_view prefix, size_t limit) {
+    std::shared_ptr<const TermDictionary> current = get_dictionary();
+    if (!current) {
+        return {};
     }
+    return current->complete(prefix, limit);
+}
 
-    return std::log10((double)n / (double)term_count);
+/*
+ * short terms allow a single edit, longer ones two, only the closest
+ * terms are used and the most frequent of them first
+ * with segments the dictionary is rebuilt in the background and may not know
+ * terms of just reindexed documents yet, the postings have the final say
+ */
+std::vector<std::string> Index::expand_terms(const std::vector<std::string> &input_values) {
+    std::shared_ptr<const TermDictionary> current = get_dictionary();
+    std::vector<std::string> terms;
+    auto add = [&terms](const std::string &term) {
+        if (std::find(terms.begin(), terms.end(), term) == terms.end()) {
+            terms.push_back(term);
+        }
+    };
+
+    for (auto &input : input_values) {
+        if (!current || input.size() < 3 || is_stopword(input) || current->document_frequency(input) > 0) {
+            add(input);
+            continue;
+        }
+        if (segments && !segments->find(input).empty()) {
+            add(input);
+            continue;
+        }
+
+        int max_distance = input.size() <= 4 ? 1 : 2;
+        std::vector<DictionaryEntry> matches;
+        for (int distance = 1; distance <= max_distance && matches.empty(); ++distance) {
+            matches = current->fuzzy(input, distance, FUZZY_EXPANSIONS);
+        }
+        if (matches.empty()) {
+            add(input);
+            continue;
+        }
+        for (auto &match : matches) {
+            Logger::debug(LogComponent::INDEX, "Expanded ", input, " to ", match.term);
+            add(match.term);
+        }
+    }
+    return terms;
 }
 
 /*
@@ -175,24 +777,179 @@ double Index::inverse_doc_frequency(std::string term, const std::vector<std::uni
  * if a documents changed, the index also has to be rebuild
  */
 void Index::rebuild_index() {
-    bool reindex_tfidf = false;
-    for (auto &document : documents) {
-        if (document->needs_reindexing()) {
-            document->index_document();
-            reindex_tfidf = true;
+    /*
+     * documents whose content changed, with the fingerprint they were indexed with,
+     * modified files are hashed on the thread pool, the result is in document order
+     */
+    std::vector<std::pair<Document *, Fingerprint>> changed;
+    pool->parallel_for(0, documents.size(), 16, [&](size_t i) {
+        Fingerprint previous = documents[i]->get_fingerprint();
+        if (documents[i]->needs_reindexing()) {
+            std::lock_guard<std::mutex> lock(mtx);
+            changed.emplace_back(documents[i].get(), previous);
+        }
+    });
+
+    if (changed.empty()) {
+        return;
+    }
+    std::sort(changed.begin(), changed.end(),
+              [](const auto &a, const auto &b) { return a.first->get_id() < b.first->get_id(); });
+
+    /* aliases which took over the postings of a changed document */
+    std::vector<Document *> successors;
+    for (auto &[document, previous] : changed) {
+        if (Document *successor = detach_document(document, previous)) {
+            successors.push_back(successor);
+        }
+    }
+
+    /*
+     * the segment postings of changed documents are deleted before they are
+     * indexed again, the postings of a previous canonical document are stored
+     * under its id, so a successor is indexed again under its own id
+     */
+    if (segments) {
+        std::unordered_set<uint32_t> removed;
+        for (auto &[document, previous] : changed) {
+            removed.insert(document->get_id());
+        }
+        segments->remove_documents(removed);
+    }
+
+    std::vector<Document *> batch;
+    for (auto &[document, previous] : changed) {
+        if (assign_document(document)) {
+            batch.push_back(document);
         }
     }
+
     /*
      * if one document is changed the tfidf index needs to be rebuild
      * and stored on the filesystem again
      */
-    if (reindex_tfidf) {
-        build_tfidf_index();
+    if (!segments) {
+        index_documents(batch);
+        Logger::info(LogComponent::INDEX, "Reindexed ", changed.size(), " changed documents");
+        build_dictionary();
+        if (config.layout == IndexLayout::IMPACT) {
+            build_impact_index();
+        } else {
+            build_tfidf_index();
+        }
+        return;
+    }
+
+    /* the changed documents are new small segments, merged in the background */
+    for (auto *successor : successors) {
+        if (successor->is_alias() || std::any_of(changed.begin(), changed.end(),
+                                                 [&](const auto &entry) { return entry.first == successor; })) {
+            continue;
+        }
+        batch.push_back(successor);
     }
+    index_documents(batch);
+    Logger::info(LogComponent::INDEX, "Reindexed ", changed.size(), " changed documents");
+    segments->flush();
+    schedule_dictionary_build();
+}
+
+/*
+ * if a document with the same content is already known, the document becomes
+ * an alias of it and shares its postings, otherwise it becomes the canonical
+ * document of its content and has to be indexed
+ */
+bool Index::assign_document(Document *document) {
+    auto it = canonical_documents.find(document->get_fingerprint());
+    if (it != canonical_documents.end() && it->second != document) {
+        Logger::debug(LogComponent::INDEX, "Duplicate of ", it->second->get_filepath(), ": ", document->get_filepath());
+        it->second->add_alias(document);
+        return false;
+    }
+
+    canonical_documents[document->get_fingerprint()] = document;
+    return true;
+}
+
+/*
+ * reading and tokenizing is spread over the thread pool, one task per document,
+ * with segments the documents are indexed in slices, so only the concordances
+ * of one slice are held before their postings go to the build buffer
+ */
+void Index::index_documents(const std::vector<Document *> &batch) {
+    size_t slice = segments ? pool->get_thread_count() * SEGMENT_SLICE_PER_THREAD : batch.size();
+    for (size_t begin = 0; begin < batch.size(); begin += slice) {
+        size_t end = std::min(batch.size(), begin + slice);
+        pool->parallel_for(begin, end, 1, [&](size_t i) {
+            try {
+                batch[i]->index_document(document_store.get());
+            } catch (std::exception &e) {
+                Logger::error(LogComponent::INDEX, "Exception caught indexing file: ", e.what());
+            }
+        });
+
+        if (segments) {
+            for (size_t i = begin; i < end; ++i) {
+                add_to_segments(batch[i]);
+            }
+        }
+    }
+}
+
+/*
+ * with segments the document only keeps its postings until they are in the build buffer
+ */
+void Index::add_to_segments(Document *document) {
+    for (auto &term : document->get_concordance()) {
+        if (is_stopword(term.first)) {
+            continue;
+        }
+        segments->add_posting(term.first, document->get_id(), term.second.count, term.second.first_offset);
+    }
+    document->clear_postings();
+}
+
+/*
+ * an alias simply leaves its canonical document, a canonical document hands its
+ * postings and remaining aliases over to its first alias, which still has the
+ * previous content
+ */
+Document *Index::detach_document(Document *document, const Fingerprint &previous) {
+    if (document->is_alias()) {
+        document->get_alias_of()->remove_alias(document);
+        return nullptr;
+    }
+
+    auto it = canonical_documents.find(previous);
+    if (it == canonical_documents.end() || it->second != document) {
+        return nullptr;
+    }
+
+    std::vector<Document *> aliases = document->get_aliases();
+    if (aliases.empty()) {
+        canonical_documents.erase(it);
+        return nullptr;
+    }
+
+    Document *successor = aliases.front();
+    for (auto *alias : aliases) {
+        document->remove_alias(alias);
+    }
+    successor->adopt_postings(*document);
+    if (document_store) {
+        document_store->copy(document->get_id(), successor->get_id());
+    }
+    for (auto *alias : aliases) {
+        if (alias != successor) {
+            successor->add_alias(alias);
+        }
+    }
+    it->second = successor;
+    return successor;
 }
 
 void Index::run_reindexing() {
-    std::cout << "Start reindexing" << std::endl;
+    Logger::info(LogComponent::INDEX, "Start reindexing");
     rebuild_index();
 }
 
@@ -214,14 +971,18 @@ void Index::read_stopwords(const std::string &filepath) {
             stopwords.push_back(word);
         }
     } catch (std::exception &e) {
-        std::cerr << "Exception ocurred reading stop words: " << e.what() << std::endl;
+        Logger::error(LogComponent::INDEX, "Exception ocurred reading stop words: ", e.what());
         stopwords.clear();
         return;
     }
 }
 
+bool Index::is_stopword(std::string_view term) const {
+    return std::find(stopwords.begin(), stopwords.end(), term) != stopwords.end();
+}
+
 void Index::print_tfidf_index() {
-    std::cout << "Printing tfidf_index" << std::endl;
+    Logger::info(LogComponent::INDEX, "Printing tfidf_index");
     for (const auto &document: documents) {
         document->print_tfidf_scores();
     }
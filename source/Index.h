@@ -6,25 +6,131 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "Document.h"
+#include "DocumentStore.h"
+#include "Fingerprint.h"
+#include "ImpactIndex.h"
+#include "SegmentIndex.h"
+#include "TermDictionary.h"
+#include "TextCache.h"
+#include "ThreadPool.h"
+
+/* an excerpt of the document text, highlights are ranges of matched words in the text */
+struct Snippet {
+    std::string text;
+    std::vector<std::pair<size_t, size_t>> highlights;
+    /* the text doesnt start at the begin or stop at the end of the document */
+    bool truncated_front = false;
+    bool truncated_back = false;
+};
+
+/* a document matching a query, aliases are other files with identical content */
+struct SearchResult {
+    std::string filepath;
+    double score;
+    std::vector<std::string> aliases;
+
+    uint32_t doc_id = 0;
+    /* offsets of the first occurrences of the matched terms in the document text */
+    std::vector<uint32_t> term_offsets;
+    /* only set by add_snippets */
+    Snippet snippet;
+};
+
+/*
+ *   layout of the in memory index, tfidf keeps the exact scores per document,
+ *   impact keeps quantized scores per term ordered by impact
+ */
+enum class IndexLayout { TFIDF, IMPACT };
+
+/* optional settings of the index, set from the command line */
+struct IndexConfig {
+    /* size cap of the extracted text cache under the index path, 0 disables the cache */
+    uintmax_t text_cache_bytes = 256 * 1024 * 1024;
+
+    /*
+     *   memory budget for postings while building, if set the postings are
+     *   written to segments under the index path instead of being kept in RAM
+     */
+    size_t max_build_memory = 0;
+
+    /* number of segments of similar size that are merged into one */
+    size_t merge_factor = 4;
+
+    /* write rate of background merges, 0 is unlimited */
+    size_t merge_bytes_per_second = 32 * 1024 * 1024;
+
+    /* keep the compressed text of every document under the index path, used for snippets */
+    bool store_documents = true;
+
+    /* only used without a build memory budget */
+    IndexLayout layout = IndexLayout::TFIDF;
+
+    /* postings scored per query with the impact layout, 0 scores all */
+    size_t impact_budget = 0;
+};
+
+/* numbers exposed for tuning, the segment part is only filled with segments */
+struct IndexStatistics {
+    int documents;
+    int unique_documents;
+    bool segmented;
+    SegmentIndex::Statistics segments;
+    /* uncompressed and on disk size of the document store */
+    uint64_t stored_text_bytes;
+    uint64_t stored_file_bytes;
+    size_t dictionary_terms;
+    size_t dictionary_states;
+    size_t dictionary_bytes;
+    ThreadPool::Statistics thread_pool;
+    bool impact_layout;
+    ImpactIndex::Statistics impacts;
+};
 
 class Index {
    public:
-    Index(std::string directory, std::string index_path, int thread_num);
+    Index(std::string directory, std::string index_path, int thread_num, IndexConfig config = {});
     ~Index() = default;
 
     /*
      *   calculates a ranking from tfidf index and returns the documents with
      * the highest rank, based on the input
      */
-    std::vector<std::pair<std::string, double>> queryIndex(
+    std::vector<SearchResult> queryIndex(
         const std::vector<std::string> &input_values);
 
+    /*
+     *   evaluates many queries at once, the postings of a term are fetched once
+     *   for the whole batch and the queries are ranked on the thread pool,
+     *   returns the best limit results of every query in the order of the queries
+     */
+    std::vector<std::vector<SearchResult>> query_batch(const std::vector<std::vector<std::string>> &queries,
+                                                       size_t limit);
+
+    /*
+     *   adds a snippet around the matched terms, with the terms highlighted,
+     *   to the first count results, needs the document store
+     */
+    void add_snippets(std::vector<SearchResult> &results, const std::vector<std::string> &input_values,
+                      size_t count);
+
+    /* completions of the prefix from the vocabulary, by descending document frequency */
+    std::vector<DictionaryEntry> suggest(std::string_view prefix, size_t limit);
+
+    /*
+     *   replaces the input values without any hits by the closest terms of the
+     *   vocabulary within a small edit distance, other values are kept
+     */
+    std::vector<std::string> expand_terms(const std::vector<std::string> &input_values);
+
     int get_document_counter();
+    int get_unique_document_counter();
+    IndexStatistics get_statistics();
     void run_reindexing();
     void print_tfidf_index();
 
@@ -32,27 +138,79 @@ class Index {
     /* vector of all Documents in the index */
     std::vector<std::unique_ptr<Document>> documents;
 
+    /* the canonical document for every distinct content in the index */
+    std::unordered_map<Fingerprint, Document *, FingerprintHash> canonical_documents;
+
     /* holds the path to the index on the filesystem */
     std::string index_path;
+    IndexConfig config;
+
+    /* extracted text of PDF and XML files, stored under the index path */
+    std::unique_ptr<TextCache> text_cache;
+
+    /*
+     *   vocabulary of the index with document frequencies, rebuilt with the index,
+     *   with segments it is replaced by a background build, readers use get_dictionary
+     */
+    std::shared_ptr<const TermDictionary> dictionary;
+    std::mutex dictionary_mtx;
+    bool dictionary_building = false;
+    /* documents changed while the background build was running */
+    bool dictionary_stale = false;
+
+    /* compressed text of the indexed documents */
+    std::unique_ptr<DocumentStore> document_store;
+
+    /* quantized scores, only used with the impact layout */
+    std::unique_ptr<ImpactIndex> impacts;
+
+    /* on disk postings, only used with a build memory budget */
+    std::unique_ptr<SegmentIndex> segments;
 
     /* stopwords which are read from a txt file */
     std::vector<std::string> stopwords;
 
-    /* threading */
-    int thread_num;
+    /* threading, the pool is shared by all indexing phases */
     std::mutex mtx;
-    std::vector<std::thread> threads;
+    std::unique_ptr<ThreadPool> pool;
 
     void build_document_index(std::string directory);
     void build_tfidf_index();
+    void build_impact_index();
+    void build_dictionary();
+    /* rebuilds the dictionary on the thread pool, at most one build runs at a time */
+    void schedule_dictionary_build();
+    std::shared_ptr<const TermDictionary> get_dictionary();
     void rebuild_index();
     void read_stopwords(const std::string &filepath);
 
+    /*
+     *   registers the document as alias of a document with the same content,
+     *   or as canonical document of its content, then it returns true and has to be indexed
+     */
+    bool assign_document(Document *document);
+    /* indexes the documents on the thread pool */
+    void index_documents(const std::vector<Document *> &batch);
+    /*
+     *   removes a changed document from the duplicate bookkeeping of its previous content,
+     *   returns the alias which took over as canonical document or nullptr
+     */
+    Document *detach_document(Document *document, const Fingerprint &previous);
+
+    /* moves the postings of an indexed document into the segment build buffer */
+    void add_to_segments(Document *document);
+    std::vector<SearchResult> query_segments(const std::vector<std::string> &input_values);
+    std::vector<SearchResult> query_impacts(const std::vector<std::string> &input_values);
+    /* the score of every document containing the term, for each of the terms */
+    std::vector<std::vector<std::pair<uint32_t, double>>> fetch_postings(const std::vector<std::string> &terms);
+    SearchResult make_result(const Document &document, double rank);
+    Snippet make_snippet(const SearchResult &result, const std::vector<std::string> &input_values);
+    bool is_stopword(std::string_view term) const;
+
     /* calculates the inverse_doc_frequency of a term over the whole corpus */
-    double inverse_doc_frequency(
-        std::string term, const std::vector<std::unique_ptr<Document>> &corpus);
+    double inverse_doc_frequency(std::string_view term);
 
-    void calculate_tfidf_index(int start_index, int end_index);
+    void calculate_tfidf_scores(Document &document);
 };
 
 #endif
\ No newline at end of file
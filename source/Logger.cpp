@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <stdexcept>
+
+#include "Logger.h"
+
+namespace {
+
+const char *level_names[] = {"DEBUG", "INFO", "WARN", "ERROR", "OFF"};
+const char *component_names[] = {"main", "index", "document", "session", "server", "timer", "cache", "segment"};
+
+LogLevel parse_level(const std::string &name) {
+    for (size_t i = 0; i < std::size(level_names); ++i) {
+        std::string level = level_names[i];
+        std::transform(level.begin(), level.end(), level.begin(), [](auto c) { return std::tolower(c); });
+        if (level == name) {
+            return static_cast<LogLevel>(i);
+        }
+    }
+    throw std::runtime_error("Unknown log level: " + name);
+}
+
+LogComponent parse_component(const std::string &name) {
+    for (size_t i = 0; i < std::size(component_names); ++i) {
+        if (name == component_names[i]) {
+            return static_cast<LogComponent>(i);
+        }
+    }
+    throw std::runtime_error("Unknown log component: " + name);
+}
+
+}  // namespace
+
+Logger &Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() : ring(std::make_unique<Entry[]>(RING_CAPACITY)) {
+    for (auto &level : levels) {
+        level.store(LogLevel::INFO, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < RING_CAPACITY; ++i) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    worker = std::thread([this]() { this->drain(); });
+}
+
+/*
+ *   stops the background thread, everything still in the buffer is written
+ */
+Logger::~Logger() {
+    running.store(false, std::memory_order_release);
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void Logger::configure(const std::string &spec) {
+    std::stringstream iss(spec);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        size_t pos = item.find('=');
+        if (pos == std::string::npos) {
+            LogLevel level = parse_level(item);
+            for (size_t i = 0; i < levels.size(); ++i) {
+                set_level(static_cast<LogComponent>(i), level);
+            }
+        } else {
+            set_level(parse_component(item.substr(0, pos)), parse_level(item.substr(pos + 1)));
+        }
+    }
+}
+
+void Logger::set_level(LogComponent component, LogLevel level) {
+    levels[static_cast<size_t>(component)].store(level, std::memory_order_relaxed);
+}
+
+void Logger::push(LogComponent component, LogLevel level, std::string_view message) {
+    uint32_t suppressed = 0;
+    if (level >= LogLevel::WARN && !pass_rate_limit(component, message, suppressed)) {
+        return;
+    }
+
+    if (!try_push(component, level, message, suppressed)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/*
+ *   claims the next free slot of the ring, never blocks,
+ *   returns false if the ring is full
+ */
+bool Logger::try_push(LogComponent component, LogLevel level, std::string_view message, uint32_t suppressed) {
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    Entry *entry;
+    while (true) {
+        entry = &ring[pos % RING_CAPACITY];
+        size_t sequence = entry->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    entry->time = std::chrono::system_clock::now();
+    entry->level = level;
+    entry->component = component;
+    entry->suppressed = suppressed;
+    entry->length = static_cast<uint16_t>(std::min(message.size(), MAX_MESSAGE));
+    entry->truncated = message.size() > MAX_MESSAGE;
+    message.copy(entry->text, entry->length);
+    entry->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+/*
+ *   only called from the background thread, formats the next entry into line
+ */
+bool Logger::try_pop(std::string &line, bool &is_error) {
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    Entry &entry = ring[pos % RING_CAPACITY];
+    size_t sequence = entry.sequence.load(std::memory_order_acquire);
+    if (sequence != pos + 1) {
+        return false;
+    }
+    dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(entry.time.time_since_epoch()).count() % 1000;
+    std::time_t seconds = std::chrono::system_clock::to_time_t(entry.time);
+    std::tm tm;
+    localtime_r(&seconds, &tm);
+    char prefix[64];
+    size_t written = std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &tm);
+    std::snprintf(prefix + written, sizeof(prefix) - written, ".%03d %-5s [%s] ", static_cast<int>(millis),
+                  level_names[static_cast<size_t>(entry.level)],
+                  component_names[static_cast<size_t>(entry.component)]);
+
+    line.assign(prefix);
+    if (entry.suppressed > 0) {
+        line.append("(suppressed " + std::to_string(entry.suppressed) + " repeats) ");
+    }
+    line.append(entry.text, entry.length);
+    if (entry.truncated) {
+        line.append("...");
+    }
+    line.push_back('\n');
+    is_error = entry.level >= LogLevel::WARN;
+
+    /* hand the slot back to the producers */
+    entry.sequence.store(pos + RING_CAPACITY, std::memory_order_release);
+    return true;
+}
+
+/*
+ *   background thread, writes everything in the ring and only flushes the
+ *   streams once the ring is empty, sleeps with backoff when idle
+ */
+void Logger::drain() {
+    std::string line;
+    bool is_error = false;
+    auto idle = std::chrono::microseconds(100);
+
+    while (true) {
+        bool wrote = false;
+        while (try_pop(line, is_error)) {
+            std::fwrite(line.data(), 1, line.size(), is_error ? stderr : stdout);
+            wrote = true;
+        }
+
+        uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0) {
+            std::fprintf(stderr, "log buffer full, dropped %llu messages\n", static_cast<unsigned long long>(lost));
+        }
+
+        if (wrote || lost > 0) {
+            std::fflush(stdout);
+            std::fflush(stderr);
+            idle = std::chrono::microseconds(100);
+            continue;
+        }
+
+        if (!running.load(std::memory_order_acquire)) {
+            break;
+        }
+        std::this_thread::sleep_for(idle);
+        idle = std::min(idle * 2, std::chrono::microseconds(std::chrono::milliseconds(10)));
+    }
+}
+
+bool Logger::pass_rate_limit(LogComponent component, std::string_view message, uint32_t &suppressed) {
+    uint64_t key = std::hash<std::string_view>{}(message) ^ (static_cast<uint64_t>(component) << 56);
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(rate_limit_mtx);
+    RateLimitSlot &slot = rate_limit_slots[key % RATE_LIMIT_SLOTS];
+    if (slot.key != key || now - slot.window_start >= RATE_LIMIT_WINDOW) {
+        /* report the repeats of the previous window with the next message of the same kind */
+        suppressed = (slot.key == key) ? slot.suppressed : 0;
+        slot.key = key;
+        slot.window_start = now;
+        slot.count = 1;
+        slot.suppressed = 0;
+        return true;
+    }
+
+    if (slot.count < RATE_LIMIT_BURST) {
+        slot.count++;
+        return true;
+    }
+
+    slot.suppressed++;
+    return false;
+}
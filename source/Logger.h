@@ -0,0 +1,132 @@
+#ifndef _H_LOGGER
+#define _H_LOGGER
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+enum class LogLevel { DEBUG = 0, INFO, WARN, ERROR, OFF };
+
+/* every part of cearch logs under its own component, levels are set per component */
+enum class LogComponent { MAIN = 0, INDEX, DOCUMENT, SESSION, SERVER, TIMER, CACHE, SEGMENT, COUNT };
+
+/*
+ *   Asynchronous leveled logger
+ *   Callers format their message and push it into a lock free ring buffer,
+ *   a background thread drains the buffer and writes to stdout/stderr.
+ *   If the buffer is full the message is dropped instead of blocking the caller,
+ *   the number of dropped messages is reported once there is room again.
+ *   Repeated warnings and errors are rate limited per component and message.
+ */
+class Logger {
+   public:
+    static Logger &instance();
+
+    ~Logger();
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    /*
+     *   parses a level specification like "info,index=debug,session=warn",
+     *   a bare level sets every component, throws on unknown names
+     */
+    void configure(const std::string &spec);
+    void set_level(LogComponent component, LogLevel level);
+
+    bool enabled(LogComponent component, LogLevel level) const {
+        return level >= levels[static_cast<size_t>(component)].load(std::memory_order_relaxed);
+    }
+
+    template <typename... Args>
+    void log(LogComponent component, LogLevel level, Args &&...args) {
+        if (!enabled(component, level)) {
+            return;
+        }
+        /* reuse the stream buffer of this thread instead of allocating per message */
+        thread_local std::ostringstream oss;
+        oss.str("");
+        oss.clear();
+        (oss << ... << std::forward<Args>(args));
+        push(component, level, oss.view());
+    }
+
+    /* shorthands, used everywhere in cearch */
+    template <typename... Args>
+    static void debug(LogComponent component, Args &&...args) {
+        instance().log(component, LogLevel::DEBUG, std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    static void info(LogComponent component, Args &&...args) {
+        instance().log(component, LogLevel::INFO, std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    static void warn(LogComponent component, Args &&...args) {
+        instance().log(component, LogLevel::WARN, std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    static void error(LogComponent component, Args &&...args) {
+        instance().log(component, LogLevel::ERROR, std::forward<Args>(args)...);
+    }
+
+   private:
+    Logger();
+
+    static constexpr size_t RING_CAPACITY = 4096;
+    static constexpr size_t MAX_MESSAGE = 240;
+
+    /* rate limiting: at most RATE_LIMIT_BURST equal messages per window */
+    static constexpr size_t RATE_LIMIT_SLOTS = 64;
+    static constexpr int RATE_LIMIT_BURST = 5;
+    static constexpr std::chrono::seconds RATE_LIMIT_WINDOW{1};
+
+    struct Entry {
+        std::atomic<size_t> sequence;
+        std::chrono::system_clock::time_point time;
+        LogLevel level;
+        LogComponent component;
+        uint32_t suppressed;
+        uint16_t length;
+        /* the message was longer than MAX_MESSAGE and cut */
+        bool truncated;
+        char text[MAX_MESSAGE];
+    };
+
+    struct RateLimitSlot {
+        uint64_t key = 0;
+        std::chrono::steady_clock::time_point window_start;
+        int count = 0;
+        uint32_t suppressed = 0;
+    };
+
+    void push(LogComponent component, LogLevel level, std::string_view message);
+    bool try_push(LogComponent component, LogLevel level, std::string_view message, uint32_t suppressed);
+    bool try_pop(std::string &line, bool &is_error);
+    void drain();
+
+    /* returns false if the message has to be dropped, sets the number of suppressed repeats */
+    bool pass_rate_limit(LogComponent component, std::string_view message, uint32_t &suppressed);
+
+    std::array<std::atomic<LogLevel>, static_cast<size_t>(LogComponent::COUNT)> levels;
+
+    /* bounded multi producer ring buffer, every slot carries a sequence number */
+    std::unique_ptr<Entry[]> ring;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+    std::atomic<uint64_t> dropped{0};
+
+    std::mutex rate_limit_mtx;
+    std::array<RateLimitSlot, RATE_LIMIT_SLOTS> rate_limit_slots;
+
+    std::atomic<bool> running{true};
+    std::thread worker;
+};
+
+#endif
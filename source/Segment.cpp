@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Segment.h"
+
+namespace {
+
+constexpr char MAGIC[4] = {'C', 'S', 'E', 'G'};
+constexpr uint32_t VERSION = 3;
+
+uint32_t read_u32(const char *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint64_t read_u64(const char *p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+}  // namespace
+
+Segment::Segment(const std::string &path) : path(path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open segment: " + path);
+    }
+
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(Footer)) {
+        ::close(fd);
+        throw std::runtime_error("Invalid segment: " + path);
+    }
+    size = file_stat.st_size;
+
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Failed to map segment: " + path);
+    }
+    data = static_cast<const char *>(mapping);
+
+    std::memcpy(&footer, data + size - sizeof(Footer), sizeof(Footer));
+    if (std::memcmp(footer.magic, MAGIC, sizeof(MAGIC)) != 0 || footer.version != VERSION ||
+        footer.sparse_offset > footer.documents_offset ||
+        footer.documents_offset + footer.document_count * sizeof(uint32_t) > size - sizeof(Footer)) {
+        ::munmap(const_cast<char *>(data), size);
+        throw std::runtime_error("Invalid segment: " + path);
+    }
+
+    /* load the sparse term index */
+    sparse_index.reserve(footer.sparse_count);
+    const char *p = data + footer.sparse_offset;
+    for (uint64_t i = 0; i < footer.sparse_count; ++i) {
+        uint32_t length = read_u32(p);
+        std::string_view term(p + sizeof(uint32_t), length);
+        p += sizeof(uint32_t) + length;
+        sparse_index.emplace_back(term, read_u64(p));
+        p += sizeof(uint64_t);
+    }
+}
+
+Segment::~Segment() {
+    if (data != nullptr) {
+        ::munmap(const_cast<char *>(data), size);
+    }
+}
+
+/*
+ *   binary search in the sparse index for the block that can contain the term,
+ *   then a linear scan of at most SPARSE_INTERVAL terms of that block
+ */
+bool Segment::find(std::string_view term, std::vector<Posting> &postings) const {
+    auto block = std::upper_bound(sparse_index.begin(), sparse_index.end(), term,
+                                  [](std::string_view value, const auto &entry) { return value < entry.first; });
+    if (block == sparse_index.begin()) {
+        return false;
+    }
+    --block;
+
+    uint64_t offset = block->second;
+    uint64_t end = (block + 1 == sparse_index.end()) ? footer.sparse_offset : (block + 1)->second;
+    while (offset < end) {
+        uint32_t length = read_u32(data + offset);
+        std::string_view current(data + offset + sizeof(uint32_t), length);
+        offset += sizeof(uint32_t) + length;
+        uint32_t count = read_u32(data + offset);
+        offset += sizeof(uint32_t);
+
+        if (current == term) {
+            size_t previous = postings.size();
+            postings.resize(previous + count);
+            std::memcpy(postings.data() + previous, data + offset, count * sizeof(Posting));
+            return true;
+        }
+        if (current > term) {
+            return false;
+        }
+        offset += static_cast<uint64_t>(count) * sizeof(Posting);
+    }
+    return false;
+}
+
+/* binary search in the sorted document ids at the end of the segment */
+bool Segment::contains_document(uint32_t doc_id) const {
+    uint64_t low = 0;
+    uint64_t high = footer.document_count;
+    while (low < high) {
+        uint64_t mid = (low + high) / 2;
+        uint32_t value = read_u32(data + footer.documents_offset + mid * sizeof(uint32_t));
+        if (value == doc_id) {
+            return true;
+        }
+        if (value < doc_id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return false;
+}
+
+const std::string &Segment::get_path() const { return path; }
+
+bool Tombstones::contains(uint32_t doc_id) const {
+    return doc_id / 64 < bits.size() && (bits[doc_id / 64] >> (doc_id % 64)) & 1;
+}
+
+void Tombstones::insert(uint32_t doc_id) {
+    if (contains(doc_id)) {
+        return;
+    }
+    if (doc_id / 64 >= bits.size()) {
+        bits.resize(doc_id / 64 + 1);
+    }
+    bits[doc_id / 64] |= uint64_t(1) << (doc_id % 64);
+    deleted++;
+}
+
+size_t Tombstones::count() const { return deleted; }
+
+uint64_t Segment::get_term_count() const { return footer.term_count; }
+
+uint64_t Segment::get_posting_count() const { return footer.posting_count; }
+
+uint64_t Segment::get_document_count() const { return footer.document_count; }
+
+size_t Segment::get_size() const { return size; }
+
+Segment::Cursor::Cursor(const Segment &segment) : segment(&segment), offset(0) { decode(); }
+
+bool Segment::Cursor::valid() const { return offset < segment->footer.sparse_offset; }
+
+std::string_view Segment::Cursor::term() const { return current_term; }
+
+uint32_t Segment::Cursor::posting_count() const { return current_count; }
+
+void Segment::Cursor::read_postings(std::vector<Posting> &postings) const {
+    size_t previous = postings.size();
+    postings.resize(previous + current_count);
+    std::memcpy(postings.data() + previous, segment->data + postings_offset, current_count * sizeof(Posting));
+}
+
+void Segment::Cursor::next() {
+    offset = postings_offset + static_cast<uint64_t>(current_count) * sizeof(Posting);
+    decode();
+}
+
+void Segment::Cursor::decode() {
+    if (!valid()) {
+        return;
+    }
+    uint32_t length = read_u32(segment->data + offset);
+    current_term = std::string_view(segment->data + offset + sizeof(uint32_t), length);
+    current_count = read_u32(segment->data + offset + sizeof(uint32_t) + length);
+    postings_offset = offset + 2 * sizeof(uint32_t) + length;
+}
+
+SegmentWriter::SegmentWriter(const std::string &path) : path(path), buffer(1024 * 1024) {
+    out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to create segment: " + path);
+    }
+}
+
+void SegmentWriter::add_term(std::string_view term, const Posting *postings, size_t count) {
+    if (term_count > 0 && term <= last_term) {
+        throw std::logic_error("Segment terms have to be added in ascending order: " + std::string(term));
+    }
+
+    if (term_count % Segment::SPARSE_INTERVAL == 0) {
+        sparse_index.emplace_back(term, offset);
+    }
+    last_term.assign(term);
+    term_count++;
+    posting_count += count;
+
+    write_u32(term.size());
+    out.write(term.data(), term.size());
+    write_u32(count);
+    out.write(reinterpret_cast<const char *>(postings), count * sizeof(Posting));
+    offset += term.size() + count * sizeof(Posting);
+
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t doc_id = postings[i].doc_id;
+        if (doc_id / 64 >= documents.size()) {
+            documents.resize(doc_id / 64 + 1);
+        }
+        documents[doc_id / 64] |= uint64_t(1) << (doc_id % 64);
+    }
+}
+
+size_t SegmentWriter::finish() {
+    Segment::Footer footer;
+    footer.sparse_offset = offset;
+    footer.sparse_count = sparse_index.size();
+    footer.term_count = term_count;
+    footer.posting_count = posting_count;
+    std::memcpy(footer.magic, MAGIC, sizeof(MAGIC));
+    footer.version = VERSION;
+
+    for (auto &[term, term_offset] : sparse_index) {
+        write_u32(term.size());
+        out.write(term.data(), term.size());
+        write_u64(term_offset);
+        offset += term.size();
+    }
+
+    footer.documents_offset = offset;
+    footer.document_count = 0;
+    for (size_t word = 0; word < documents.size(); ++word) {
+        for (uint64_t rest = documents[word]; rest != 0; rest &= rest - 1) {
+            write_u32(static_cast<uint32_t>(word * 64 + __builtin_ctzll(rest)));
+            footer.document_count++;
+        }
+    }
+
+    out.write(reinterpret_cast<const char *>(&footer), sizeof(footer));
+    offset += sizeof(footer);
+
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Failed to write segment: " + path);
+    }
+    return offset;
+}
+
+uint64_t SegmentWriter::get_offset() const { return offset; }
+
+void SegmentWriter::write_u32(uint32_t value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    offset += sizeof(value);
+}
+
+void SegmentWriter::write_u64(uint64_t value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    offset += sizeof(value);
+}
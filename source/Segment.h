@@ -0,0 +1,157 @@
+#ifndef _H_SEGMENT
+#define _H_SEGMENT
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ *   a document containing a term, the number of times it contains it and
+ *   the offset of the first occurrence in the document text
+ */
+struct Posting {
+    uint32_t doc_id;
+    uint32_t term_frequency;
+    uint32_t first_offset;
+};
+
+/*
+ *   per segment bitmap of deleted documents
+ *   readers hold a shared pointer to an instance that is never changed again,
+ *   new deletions are made on a copy
+ */
+class Tombstones {
+   public:
+    bool contains(uint32_t doc_id) const;
+    void insert(uint32_t doc_id);
+    /* number of deleted documents */
+    size_t count() const;
+    /* calls fn for every deleted document */
+    template <typename Fn>
+    void for_each(Fn &&fn) const {
+        for (size_t word = 0; word < bits.size(); ++word) {
+            for (uint64_t rest = bits[word]; rest != 0; rest &= rest - 1) {
+                fn(static_cast<uint32_t>(word * 64 + __builtin_ctzll(rest)));
+            }
+        }
+    }
+
+   private:
+    std::vector<uint64_t> bits;
+    size_t deleted = 0;
+};
+
+/*
+ *   Immutable on disk segment of the inverted index
+ *   Layout:
+ *     terms in ascending byte order, each as
+ *       u32 term length, term, u32 posting count, postings ordered by doc id
+ *     sparse term index, every SPARSE_INTERVAL-th term as
+ *       u32 term length, term, u64 offset of the term
+ *     ids of all documents in the segment, ascending u32
+ *     footer
+ *   The file is memory mapped, only the sparse term index is held in memory,
+ *   the postings are paged in by the OS when a term is looked up.
+ */
+class Segment {
+   public:
+    static constexpr uint32_t SPARSE_INTERVAL = 64;
+
+    /* maps the segment file, throws if it cant be opened or is not a segment */
+    explicit Segment(const std::string &path);
+    ~Segment();
+
+    Segment(const Segment &) = delete;
+    Segment &operator=(const Segment &) = delete;
+
+    /* appends the postings of the term, returns false if the segment doesnt contain the term */
+    bool find(std::string_view term, std::vector<Posting> &postings) const;
+
+    /* true if the segment has postings of the document */
+    bool contains_document(uint32_t doc_id) const;
+
+    const std::string &get_path() const;
+    uint64_t get_term_count() const;
+    uint64_t get_posting_count() const;
+    uint64_t get_document_count() const;
+    size_t get_size() const;
+
+    /* iterates over all terms of the segment in ascending order, used for merging */
+    class Cursor {
+       public:
+        explicit Cursor(const Segment &segment);
+
+        bool valid() const;
+        std::string_view term() const;
+        uint32_t posting_count() const;
+        void read_postings(std::vector<Posting> &postings) const;
+        void next();
+
+       private:
+        void decode();
+
+        const Segment *segment;
+        uint64_t offset;
+        std::string_view current_term;
+        uint32_t current_count = 0;
+        uint64_t postings_offset = 0;
+    };
+
+   private:
+    struct Footer {
+        uint64_t sparse_offset;
+        uint64_t sparse_count;
+        uint64_t documents_offset;
+        uint64_t document_count;
+        uint64_t term_count;
+        uint64_t posting_count;
+        char magic[4];
+        uint32_t version;
+    };
+
+    std::string path;
+    const char *data = nullptr;
+    size_t size = 0;
+    Footer footer;
+
+    /* every SPARSE_INTERVAL-th term and its offset, the views point into the mapping */
+    std::vector<std::pair<std::string_view, uint64_t>> sparse_index;
+
+    friend class SegmentWriter;
+};
+
+/*
+ *   writes a segment file sequentially, terms have to be added in ascending order
+ */
+class SegmentWriter {
+   public:
+    explicit SegmentWriter(const std::string &path);
+
+    void add_term(std::string_view term, const Posting *postings, size_t count);
+
+    /* writes the sparse term index, document ids and the footer, returns the size of the segment */
+    size_t finish();
+
+    /* bytes written so far */
+    uint64_t get_offset() const;
+
+   private:
+    void write_u32(uint32_t value);
+    void write_u64(uint64_t value);
+
+    std::string path;
+    std::vector<char> buffer;
+    std::ofstream out;
+    uint64_t offset = 0;
+    uint64_t term_count = 0;
+    uint64_t posting_count = 0;
+    std::string last_term;
+    std::vector<std::pair<std::string, uint64_t>> sparse_index;
+    /* bitmap of the documents with postings in the segment */
+    std::vector<uint64_t> documents;
+};
+
+#endif
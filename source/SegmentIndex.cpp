@@ -0,0 +1,456 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <queue>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "Logger.h"
+#include "SegmentIndex.h"
+
+namespace {
+
+constexpr const char *EXTENSION = ".seg";
+
+/* rough size of a hash node, bucket and vector header of a new term in the buffer */
+constexpr size_t BYTES_PER_TERM = 96;
+
+/* segments below this number of live postings are all in the lowest tier */
+constexpr double TIER_FLOOR = 16 * 1024;
+
+/* segments with a higher share of deleted documents are rewritten on their own */
+constexpr double MAX_DELETED_RATIO = 0.3;
+
+/* nice value of the merge thread */
+constexpr int MERGE_NICE = 10;
+
+}  // namespace
+
+/*
+ *   the index is rebuilt on every start, leftover segments of a previous run are removed
+ */
+SegmentIndex::SegmentIndex(const std::string &directory, size_t max_build_memory, size_t merge_factor,
+                           size_t merge_bytes_per_second)
+    : directory(directory), max_build_memory(max_build_memory), merge_factor(std::max<size_t>(merge_factor, 2)),
+      merge_bytes_per_second(merge_bytes_per_second),
+      buffer(std::make_unique<TermTable<std::pmr::vector<Posting>>>()) {
+    std::filesystem::create_directories(directory);
+    for (auto const &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == EXTENSION) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+
+    merger = std::thread([this]() { this->run_merges(); });
+}
+
+/*
+ *   stops the merge thread, a running merge is aborted
+ */
+SegmentIndex::~SegmentIndex() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = false;
+    }
+    merge_cv.notify_all();
+    if (merger.joinable()) {
+        merger.join();
+    }
+}
+
+size_t SegmentIndex::LiveSegment::live_documents() const {
+    return segment->get_document_count() - (tombstones ? tombstones->count() : 0);
+}
+
+void SegmentIndex::add_posting(std::string_view term, uint32_t doc_id, uint32_t term_frequency,
+                               uint32_t first_offset) {
+    auto it = buffer->terms.find(term);
+    if (it == buffer->terms.end()) {
+        it = buffer->terms.emplace(std::piecewise_construct, std::forward_as_tuple(term), std::forward_as_tuple()).first;
+        buffer_bytes += term.size() + BYTES_PER_TERM;
+    }
+    it->second.push_back({doc_id, term_frequency, first_offset});
+    /* growing vectors leave their old storage in the arena, count it twice */
+    buffer_bytes += 2 * sizeof(Posting);
+
+    if (buffer_bytes >= max_build_memory) {
+        flush();
+    }
+}
+
+/*
+ *   sorts the buffered terms and writes them as a new segment, the buffer is released as a whole
+ */
+void SegmentIndex::flush() {
+    if (buffer->terms.empty()) {
+        return;
+    }
+
+    std::vector<const std::pair<const std::pmr::string, std::pmr::vector<Posting>> *> sorted;
+    sorted.reserve(buffer->terms.size());
+    for (auto &entry : buffer->terms) {
+        sorted.push_back(&entry);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto *a, const auto *b) { return a->first < b->first; });
+
+    std::string path = next_segment_path();
+    SegmentWriter writer(path);
+    for (auto *entry : sorted) {
+        writer.add_term(entry->first, entry->second.data(), entry->second.size());
+    }
+    size_t size = writer.finish();
+    bytes_flushed += size;
+
+    Logger::debug(LogComponent::SEGMENT, "Flushed ", path, ": ", sorted.size(), " terms, ",
+                  size / 1024, " KiB, buffer estimate ", buffer_bytes / 1024, " KiB");
+
+    buffer = std::make_unique<TermTable<std::pmr::vector<Posting>>>(buffer->terms.size());
+    buffer_bytes = 0;
+
+    auto segment = std::make_shared<const Segment>(path);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        live.push_back({segment, nullptr});
+        merge_requested = true;
+    }
+    merge_cv.notify_one();
+}
+
+/*
+ *   the tombstones of a segment are copied, changed and swapped in,
+ *   so queries and merges holding the previous ones are not affected
+ */
+void SegmentIndex::remove_documents(const std::unordered_set<uint32_t> &doc_ids) {
+    if (doc_ids.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto &entry : live) {
+            std::shared_ptr<Tombstones> tombstones;
+            for (uint32_t doc_id : doc_ids) {
+                if (!entry.segment->contains_document(doc_id) || (entry.tombstones && entry.tombstones->contains(doc_id))) {
+                    continue;
+                }
+                if (!tombstones) {
+                    tombstones = entry.tombstones ? std::make_shared<Tombstones>(*entry.tombstones)
+                                                  : std::make_shared<Tombstones>();
+                }
+                tombstones->insert(doc_id);
+            }
+            if (tombstones) {
+                entry.tombstones = std::move(tombstones);
+            }
+        }
+        /* segments without live documents are compacted away by the merge thread */
+        merge_requested = true;
+    }
+    merge_cv.notify_one();
+}
+
+std::vector<Posting> SegmentIndex::find(std::string_view term) {
+    std::vector<LiveSegment> segments = snapshot();
+    lookups++;
+    segments_searched += segments.size();
+
+    std::vector<Posting> postings;
+    std::vector<Posting> segment_postings;
+    for (auto &entry : segments) {
+        segment_postings.clear();
+        if (!entry.segment->find(term, segment_postings)) {
+            continue;
+        }
+        for (auto &posting : segment_postings) {
+            if (entry.tombstones && entry.tombstones->contains(posting.doc_id)) {
+                continue;
+            }
+            postings.push_back(posting);
+        }
+    }
+    return postings;
+}
+
+/* k-way walk over the terms of all live segments, like a merge without writing */
+void SegmentIndex::for_each_term(const std::function<void(std::string_view, uint32_t)> &fn) {
+    std::vector<LiveSegment> segments = snapshot();
+    std::vector<Segment::Cursor> cursors;
+    cursors.reserve(segments.size());
+    for (auto &entry : segments) {
+        cursors.emplace_back(*entry.segment);
+    }
+    auto greater = [&cursors](size_t a, size_t b) { return cursors[a].term() > cursors[b].term(); };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        if (cursors[i].valid()) {
+            heap.push(i);
+        }
+    }
+
+    std::vector<Posting> postings;
+    while (!heap.empty()) {
+        std::string_view term = cursors[heap.top()].term();
+        uint32_t count = 0;
+        while (!heap.empty() && cursors[heap.top()].term() == term) {
+            size_t i = heap.top();
+            heap.pop();
+
+            if (!segments[i].tombstones) {
+                count += cursors[i].posting_count();
+            } else {
+                postings.clear();
+                cursors[i].read_postings(postings);
+                for (auto &posting : postings) {
+                    count += segments[i].tombstones->contains(posting.doc_id) ? 0 : 1;
+                }
+            }
+
+            cursors[i].next();
+            if (cursors[i].valid()) {
+                heap.push(i);
+            }
+        }
+        if (count > 0) {
+            fn(term, count);
+        }
+    }
+}
+
+SegmentIndex::Statistics SegmentIndex::get_statistics() {
+    Statistics statistics{};
+    for (auto &entry : snapshot()) {
+        statistics.segments++;
+        statistics.postings += entry.segment->get_posting_count();
+        statistics.deleted_documents += entry.tombstones ? entry.tombstones->count() : 0;
+    }
+    statistics.bytes_flushed = bytes_flushed;
+    statistics.bytes_merged = bytes_merged;
+    statistics.merges = merges;
+    statistics.write_amplification = statistics.bytes_flushed == 0 ? 0.0 :
+        static_cast<double>(statistics.bytes_flushed + statistics.bytes_merged) / statistics.bytes_flushed;
+    statistics.lookups = lookups;
+    statistics.average_fan_out = statistics.lookups == 0 ? 0.0 :
+        static_cast<double>(segments_searched) / statistics.lookups;
+    return statistics;
+}
+
+std::vector<SegmentIndex::LiveSegment> SegmentIndex::snapshot() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return live;
+}
+
+std::string SegmentIndex::next_segment_path() {
+    return (std::filesystem::path(directory) / ("segment-" + std::to_string(segment_counter++) + EXTENSION)).string();
+}
+
+/*
+ *   merge thread, waits for new segments or deletions and merges until
+ *   the policy finds nothing to do
+ */
+void SegmentIndex::run_merges() {
+#ifdef __linux__
+    /* on linux the nice value is per thread */
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), MERGE_NICE);
+#endif
+
+    while (true) {
+        std::vector<LiveSegment> inputs;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            merge_cv.wait_for(lock, std::chrono::seconds(10), [this]() { return merge_requested || !running; });
+            if (!running) {
+                return;
+            }
+            merge_requested = false;
+        }
+
+        while (running && !(inputs = select_merge()).empty()) {
+            try {
+                if (!merge(inputs)) {
+                    return;
+                }
+            } catch (std::exception &e) {
+                Logger::error(LogComponent::SEGMENT, "Merge failed: ", e.what());
+                break;
+            }
+        }
+    }
+}
+
+/*
+ *   tiered merge policy, segments are grouped into tiers by their number of
+ *   live postings, each tier being merge_factor times larger than the one below,
+ *   merge_factor segments of the lowest full tier are merged into one segment of
+ *   the next tier, if no tier is full a segment with too many deletions is compacted
+ */
+std::vector<SegmentIndex::LiveSegment> SegmentIndex::select_merge() {
+    std::vector<LiveSegment> segments = snapshot();
+
+    auto live_postings = [](const LiveSegment &entry) {
+        double documents = entry.segment->get_document_count();
+        return entry.segment->get_posting_count() * (documents == 0 ? 0.0 : entry.live_documents() / documents);
+    };
+
+    std::map<int, std::vector<LiveSegment>> tiers;
+    for (auto &entry : segments) {
+        double size = std::max(live_postings(entry), TIER_FLOOR);
+        int tier = static_cast<int>(std::log(size / TIER_FLOOR) / std::log(static_cast<double>(merge_factor)));
+        tiers[tier].push_back(entry);
+    }
+
+    for (auto &[tier, members] : tiers) {
+        if (members.size() < merge_factor) {
+            continue;
+        }
+        std::sort(members.begin(), members.end(),
+                  [&](const auto &a, const auto &b) { return live_postings(a) < live_postings(b); });
+        members.resize(merge_factor);
+        return members;
+    }
+
+    for (auto &entry : segments) {
+        double documents = entry.segment->get_document_count();
+        if (entry.tombstones && entry.tombstones->count() > documents * MAX_DELETED_RATIO) {
+            return {entry};
+        }
+    }
+    return {};
+}
+
+/*
+ *   k-way merge of the inputs without their deleted postings, documents deleted
+ *   while the merge was running are carried over to the tombstones of the result
+ */
+bool SegmentIndex::merge(const std::vector<LiveSegment> &inputs) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Segment::Cursor> cursors;
+    cursors.reserve(inputs.size());
+    for (auto &input : inputs) {
+        cursors.emplace_back(*input.segment);
+    }
+    auto greater = [&cursors](size_t a, size_t b) { return cursors[a].term() > cursors[b].term(); };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        if (cursors[i].valid()) {
+            heap.push(i);
+        }
+    }
+
+    std::string path = next_segment_path();
+    SegmentWriter writer(path);
+    std::vector<Posting> postings;
+    std::vector<Posting> input_postings;
+    uint64_t throttled_bytes = 0;
+    while (!heap.empty()) {
+        if (!running) {
+            std::filesystem::remove(path);
+            return false;
+        }
+
+        std::string_view term = cursors[heap.top()].term();
+        postings.clear();
+
+        while (!heap.empty() && cursors[heap.top()].term() == term) {
+            size_t i = heap.top();
+            heap.pop();
+
+            input_postings.clear();
+            cursors[i].read_postings(input_postings);
+            for (auto &posting : input_postings) {
+                if (inputs[i].tombstones && inputs[i].tombstones->contains(posting.doc_id)) {
+                    continue;
+                }
+                postings.push_back(posting);
+            }
+
+            cursors[i].next();
+            if (cursors[i].valid()) {
+                heap.push(i);
+            }
+        }
+
+        if (postings.empty()) {
+            continue;
+        }
+        if (!std::is_sorted(postings.begin(), postings.end(),
+                            [](const auto &a, const auto &b) { return a.doc_id < b.doc_id; })) {
+            std::sort(postings.begin(), postings.end(), [](const auto &a, const auto &b) { return a.doc_id < b.doc_id; });
+        }
+        writer.add_term(term, postings.data(), postings.size());
+
+        if (writer.get_offset() - throttled_bytes >= 1024 * 1024) {
+            throttled_bytes = writer.get_offset();
+            throttle(throttled_bytes, start);
+        }
+    }
+    size_t size = writer.finish();
+    auto merged = std::make_shared<const Segment>(path);
+
+    size_t segment_count;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::shared_ptr<Tombstones> tombstones;
+        for (auto &input : inputs) {
+            auto current = std::find_if(live.begin(), live.end(),
+                                        [&](const LiveSegment &entry) { return entry.segment == input.segment; });
+            if (current == live.end() || !current->tombstones || current->tombstones == input.tombstones) {
+                continue;
+            }
+            /* deletions already in the snapshot were dropped by the merge, the id may be reused by a newer segment */
+            current->tombstones->for_each([&](uint32_t doc_id) {
+                if (input.tombstones && input.tombstones->contains(doc_id)) {
+                    return;
+                }
+                if (merged->contains_document(doc_id)) {
+                    if (!tombstones) {
+                        tombstones = std::make_shared<Tombstones>();
+                    }
+                    tombstones->insert(doc_id);
+                }
+            });
+        }
+
+        std::erase_if(live, [&](const LiveSegment &entry) {
+            return std::any_of(inputs.begin(), inputs.end(),
+                               [&](const LiveSegment &input) { return input.segment == entry.segment; });
+        });
+        if (merged->get_document_count() > 0) {
+            live.push_back({merged, tombstones});
+        }
+        segment_count = live.size();
+    }
+
+    /* queries still using the inputs keep their mapping, the files can go */
+    for (auto &input : inputs) {
+        std::filesystem::remove(input.segment->get_path());
+    }
+    if (merged->get_document_count() == 0) {
+        std::filesystem::remove(path);
+    }
+
+    bytes_merged += size;
+    merges++;
+    Statistics statistics = get_statistics();
+    Logger::info(LogComponent::SEGMENT, "Merged ", inputs.size(), " segments into ", path, ": ",
+                 merged->get_posting_count(), " postings, ", size / 1024, " KiB, ", segment_count,
+                 " live segments, write amplification ", statistics.write_amplification);
+    return true;
+}
+
+/* sleeps until writing bytes since start stays within the merge rate */
+void SegmentIndex::throttle(uint64_t bytes, std::chrono::steady_clock::time_point start) {
+    if (merge_bytes_per_second == 0) {
+        return;
+    }
+    auto target = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double>(static_cast<double>(bytes) / merge_bytes_per_second));
+    std::unique_lock<std::mutex> lock(mtx);
+    /* woken up early on shutdown */
+    merge_cv.wait_until(lock, target, [this]() { return !running; });
+}
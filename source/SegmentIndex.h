@@ -0,0 +1,120 @@
+#ifndef _H_SEGMENTINDEX
+#define _H_SEGMENTINDEX
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "Segment.h"
+#include "TermTable.h"
+
+/*
+ *   Log structured inverted index made of immutable on disk segments
+ *   Postings are collected in a buffer with a memory budget (single pass in
+ *   memory indexing, SPIMI), every time the budget is exceeded or the buffer
+ *   is flushed explicitly, it is sorted and written as a new segment.
+ *   Documents are deleted by marking them in the tombstone bitmap of every
+ *   segment containing them, queries search all live segments.
+ *   A background thread with low priority merges segments of similar size
+ *   (tiered merging) and compacts segments with many deletions, the merge
+ *   writes are throttled to a configured rate.
+ */
+class SegmentIndex {
+   public:
+    /* merge_bytes_per_second of 0 disables the throttling */
+    SegmentIndex(const std::string &directory, size_t max_build_memory, size_t merge_factor,
+                 size_t merge_bytes_per_second);
+    ~SegmentIndex();
+
+    SegmentIndex(const SegmentIndex &) = delete;
+    SegmentIndex &operator=(const SegmentIndex &) = delete;
+
+    void add_posting(std::string_view term, uint32_t doc_id, uint32_t term_frequency, uint32_t first_offset);
+
+    /* writes the buffered postings as a new segment, making them searchable */
+    void flush();
+
+    /* marks the documents as deleted in every segment containing them */
+    void remove_documents(const std::unordered_set<uint32_t> &doc_ids);
+
+    /* all live postings of the term over all segments */
+    std::vector<Posting> find(std::string_view term);
+
+    /* calls fn with every term and its number of live postings, in ascending term order */
+    void for_each_term(const std::function<void(std::string_view, uint32_t)> &fn);
+
+    struct Statistics {
+        size_t segments;
+        uint64_t postings;
+        uint64_t deleted_documents;
+        uint64_t bytes_flushed;
+        uint64_t bytes_merged;
+        uint64_t merges;
+        /* bytes written by flushes and merges per byte flushed */
+        double write_amplification;
+        uint64_t lookups;
+        /* segments searched per term lookup */
+        double average_fan_out;
+    };
+    Statistics get_statistics();
+
+   private:
+    /* drives merges with a chosen snapshot */
+    friend class SegmentIndexTest;
+
+    /* a segment and its deletions, both are replaced as a whole, never modified */
+    struct LiveSegment {
+        std::shared_ptr<const Segment> segment;
+        std::shared_ptr<const Tombstones> tombstones;
+
+        size_t live_documents() const;
+    };
+
+    std::vector<LiveSegment> snapshot();
+    std::string next_segment_path();
+
+    /* background merging */
+    void run_merges();
+    /* picks the segments to merge next, empty if nothing has to be merged */
+    std::vector<LiveSegment> select_merge();
+    /* returns false if the merge was aborted on shutdown */
+    bool merge(const std::vector<LiveSegment> &inputs);
+    void throttle(uint64_t bytes, std::chrono::steady_clock::time_point start);
+
+    std::string directory;
+    size_t max_build_memory;
+    size_t merge_factor;
+    size_t merge_bytes_per_second;
+
+    /* postings of the documents added since the last flush, released per flush */
+    std::unique_ptr<TermTable<std::pmr::vector<Posting>>> buffer;
+    size_t buffer_bytes = 0;
+
+    /* guards the live segments and wakes up the merge thread */
+    std::mutex mtx;
+    std::condition_variable merge_cv;
+    std::vector<LiveSegment> live;
+    bool merge_requested = false;
+
+    std::atomic<uint64_t> segment_counter{0};
+    std::atomic<uint64_t> bytes_flushed{0};
+    std::atomic<uint64_t> bytes_merged{0};
+    std::atomic<uint64_t> merges{0};
+    std::atomic<uint64_t> lookups{0};
+    std::atomic<uint64_t> segments_searched{0};
+
+    std::atomic<bool> running{true};
+    std::thread merger;
+};
+
+#endif
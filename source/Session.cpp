@@ -1,7 +1,107 @@
+#include <cctype>
+#include <cstdio>
+
 #include "Session.h"
+#include "Logger.h"
 
 using boost::asio::ip::tcp;
 
+namespace {
+
+/* number of results shown with a snippet */
+constexpr size_t SNIPPET_RESULTS = 10;
+
+/* default and maximum number of completions of a suggest request */
+constexpr size_t SUGGESTIONS = 10;
+constexpr size_t MAX_SUGGESTIONS = 100;
+
+/* default and maximum number of results per query of a batch search, and queries per batch */
+constexpr size_t BATCH_RESULTS = 10;
+constexpr size_t MAX_BATCH_RESULTS = 1000;
+constexpr size_t MAX_BATCH_QUERIES = 10000;
+
+std::string escape_json(std::string_view text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/* value of a parameter of a url encoded query string, empty if it is missing */
+std::string query_parameter(std::string_view query, std::string_view name) {
+    size_t pos = 0;
+    while (pos <= query.size()) {
+        size_t end = query.find('&', pos);
+        if (end == std::string_view::npos) {
+            end = query.size();
+        }
+        std::string_view parameter = query.substr(pos, end - pos);
+        if (parameter.size() > name.size() && parameter.substr(0, name.size()) == name &&
+            parameter[name.size()] == '=') {
+            std::string value;
+            for (size_t i = name.size() + 1; i < parameter.size(); ++i) {
+                if (parameter[i] == '+') {
+                    value += ' ';
+                } else if (parameter[i] == '%' && i + 2 < parameter.size() &&
+                           std::isxdigit(static_cast<unsigned char>(parameter[i + 1])) &&
+                           std::isxdigit(static_cast<unsigned char>(parameter[i + 2]))) {
+                    value += static_cast<char>(std::stoi(std::string(parameter.substr(i + 1, 2)), nullptr, 16));
+                    i += 2;
+                } else {
+                    value += parameter[i];
+                }
+            }
+            return value;
+        }
+        pos = end + 1;
+    }
+    return "";
+}
+
+std::string escape_html(std::string_view text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '<': escaped += "&lt;"; break;
+            case '>': escaped += "&gt;"; break;
+            case '&': escaped += "&amp;"; break;
+            case '"': escaped += "&quot;"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/* the snippet text with the highlighted words in bold */
+std::string snippet_to_html(const Snippet &snippet) {
+    std::string html = snippet.truncated_front ? "... " : "";
+    size_t pos = 0;
+    for (auto &[start, length] : snippet.highlights) {
+        html += escape_html(std::string_view(snippet.text).substr(pos, start - pos));
+        html += "<b>" + escape_html(std::string_view(snippet.text).substr(start, length)) + "</b>";
+        pos = start + length;
+    }
+    html += escape_html(std::string_view(snippet.text).substr(pos));
+    if (snippet.truncated_back) {
+        html += " ...";
+    }
+    return html;
+}
+
+}  // namespace
+
 Session::Session(tcp::socket socket, Index &idx)
     : socket(std::move(socket)), idx(idx) {}
 
@@ -18,6 +118,170 @@ void Session::write_response() {
     m_response.version(m_request.version());
     m_response.result(http::status::ok);
     m_response.set(http::field::server, "Boost Beast");
+
+    std::string target(m_request.target().data(), m_request.target().size());
+    size_t query_pos = target.find('?');
+    std::string path = target.substr(0, query_pos);
+    std::string query = (query_pos == std::string::npos) ? "" : target.substr(query_pos + 1);
+
+    if (m_request.method() == http::verb::get && path == "/api/stats") {
+        write_statistics();
+    } else if (m_request.method() == http::verb::get && path == "/api/suggest") {
+        write_suggestions(query);
+    } else if (m_request.method() == http::verb::post && path == "/api/search/batch") {
+        write_batch_search(query);
+    } else {
+        write_search_page();
+    }
+
+    m_response.prepare_payload();
+    http::write(socket, m_response);
+}
+
+/*
+ *  the index statistics as json, used to tune segment merging
+ */
+void Session::write_statistics() {
+    IndexStatistics statistics = idx.get_statistics();
+
+    std::ostringstream oss;
+    oss << "{\"documents\":" << statistics.documents
+        << ",\"unique_documents\":" << statistics.unique_documents;
+    if (statistics.segmented) {
+        const auto &segments = statistics.segments;
+        oss << ",\"segments\":{\"count\":" << segments.segments
+            << ",\"postings\":" << segments.postings
+            << ",\"deleted_documents\":" << segments.deleted_documents
+            << ",\"bytes_flushed\":" << segments.bytes_flushed
+            << ",\"bytes_merged\":" << segments.bytes_merged
+            << ",\"merges\":" << segments.merges
+            << ",\"write_amplification\":" << segments.write_amplification
+            << ",\"lookups\":" << segments.lookups
+            << ",\"average_fan_out\":" << segments.average_fan_out << "}";
+    }
+    oss << ",\"document_store\":{\"text_bytes\":" << statistics.stored_text_bytes
+        << ",\"file_bytes\":" << statistics.stored_file_bytes << "}";
+    oss << ",\"dictionary\":{\"terms\":" << statistics.dictionary_terms
+        << ",\"states\":" << statistics.dictionary_states
+        << ",\"bytes\":" << statistics.dictionary_bytes << "}";
+    oss << ",\"thread_pool\":{\"threads\":" << statistics.thread_pool.threads
+        << ",\"tasks\":" << statistics.thread_pool.tasks
+        << ",\"steals\":" << statistics.thread_pool.steals
+        << ",\"utilization\":" << statistics.thread_pool.utilization << "}";
+    if (statistics.impact_layout) {
+        const auto &impacts = statistics.impacts;
+        oss << ",\"impact_index\":{\"postings\":" << impacts.postings
+            << ",\"blocks\":" << impacts.blocks
+            << ",\"bytes\":" << impacts.bytes
+            << ",\"queries\":" << impacts.queries
+            << ",\"early_terminations\":" << impacts.early_terminations
+            << ",\"average_postings_scored\":" << impacts.average_postings_scored << "}";
+    }
+    oss << "}";
+
+    m_response.set(http::field::content_type, "application/json");
+    beast::ostream(m_response.body()) << oss.str();
+}
+
+/*
+ *  completions of the prefix parameter as json, for search as you type,
+ *  the prefix is lower cased like the indexed terms
+ */
+void Session::write_suggestions(const std::string &query) {
+    std::string prefix = query_parameter(query, "prefix");
+    std::transform(prefix.begin(), prefix.end(), prefix.begin(), [](auto c) { return std::tolower(c); });
+
+    size_t limit = SUGGESTIONS;
+    std::string limit_value = query_parameter(query, "limit");
+    if (!limit_value.empty()) {
+        try {
+            limit = std::min<size_t>(std::stoul(limit_value), MAX_SUGGESTIONS);
+        } catch (std::exception &e) {
+            Logger::debug(LogComponent::SESSION, "Invalid suggest limit: ", limit_value);
+        }
+    }
+
+    std::ostringstream oss;
+    oss << "{\"prefix\":\"" << escape_json(prefix) << "\",\"suggestions\":[";
+    bool first = true;
+    for (auto &entry : idx.suggest(prefix, limit)) {
+        oss << (first ? "" : ",") << "{\"term\":\"" << escape_json(entry.term)
+            << "\",\"document_frequency\":" << entry.document_frequency << "}";
+        first = false;
+    }
+    oss << "]}";
+
+    m_response.set(http::field::content_type, "application/json");
+    beast::ostream(m_response.body()) << oss.str();
+}
+
+/*
+ *  the body holds one query per line, empty lines are skipped, the results of
+ *  all queries are returned as json in the order of the queries, without snippets
+ */
+void Session::write_batch_search(const std::string &query) {
+    m_response.set(http::field::content_type, "application/json");
+
+    size_t limit = BATCH_RESULTS;
+    std::string limit_value = query_parameter(query, "limit");
+    if (!limit_value.empty()) {
+        try {
+            limit = std::min<size_t>(std::stoul(limit_value), MAX_BATCH_RESULTS);
+        } catch (std::exception &e) {
+            Logger::debug(LogComponent::SESSION, "Invalid batch limit: ", limit_value);
+        }
+    }
+
+    std::vector<std::string> lines;
+    std::istringstream body(beast::buffers_to_string(m_request.body().data()));
+    for (std::string line; std::getline(body, line);) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            lines.push_back(std::move(line));
+        }
+    }
+    if (lines.size() > MAX_BATCH_QUERIES) {
+        m_response.result(http::status::payload_too_large);
+        beast::ostream(m_response.body()) << "{\"error\":\"at most " << MAX_BATCH_QUERIES << " queries per batch\"}";
+        return;
+    }
+
+    /* misspelled words are corrected like on the search page */
+    std::vector<std::vector<std::string>> queries;
+    for (auto &line : lines) {
+        /* clean_word changes its argument, the response echoes the query as sent */
+        std::string cleaned = line;
+        queries.push_back(idx.expand_terms(Document::clean_word(cleaned)));
+    }
+    std::vector<std::vector<SearchResult>> results = idx.query_batch(queries, limit);
+
+    std::ostringstream oss;
+    oss << "{\"results\":[";
+    for (size_t i = 0; i < lines.size(); ++i) {
+        oss << (i == 0 ? "" : ",") << "{\"query\":\"" << escape_json(lines[i]) << "\",\"terms\":[";
+        for (size_t t = 0; t < queries[i].size(); ++t) {
+            oss << (t == 0 ? "" : ",") << "\"" << escape_json(queries[i][t]) << "\"";
+        }
+        oss << "],\"documents\":[";
+        for (size_t r = 0; r < results[i].size(); ++r) {
+            const SearchResult &result = results[i][r];
+            oss << (r == 0 ? "" : ",") << "{\"path\":\"" << escape_json(result.filepath)
+                << "\",\"score\":" << result.score << ",\"duplicates\":[";
+            for (size_t a = 0; a < result.aliases.size(); ++a) {
+                oss << (a == 0 ? "" : ",") << "\"" << escape_json(result.aliases[a]) << "\"";
+            }
+            oss << "]}";
+        }
+        oss << "]}";
+    }
+    oss << "]}";
+
+    beast::ostream(m_response.body()) << oss.str();
+}
+
+void Session::write_search_page() {
     m_response.set(http::field::content_type, "text/html");
     std::string html_body = read_html_file("web/index.html");
 
@@ -30,7 +294,7 @@ void Session::write_response() {
             /* parse the input field, assumong its name is "input-text" */
             std::string request_body =
                 beast::buffers_to_string(m_request.body().data());
-            std::cout << "Body: " << request_body << std::endl;
+            Logger::debug(LogComponent::SESSION, "Body: ", request_body);
             size_t start_pos = request_body.find("input-text=");
             if (start_pos != std::string::npos) {
                 /* move past the name to get the value */
@@ -41,34 +305,51 @@ void Session::write_response() {
             }
         }
 
-        /* extract every single word from input value */
+        /* extract every single word from input value, misspelled words are corrected */
         input_values = Document::clean_word(input_value);
+        std::vector<std::string> terms = idx.expand_terms(input_values);
 
         /* retrieve the result from the index */
-        std::vector<std::pair<std::string, double>> result;
-        if (!input_values.empty()) {
-            result = idx.queryIndex(input_values);
+        std::vector<SearchResult> result;
+        if (!terms.empty()) {
+            result = idx.queryIndex(terms);
+            idx.add_snippets(result, terms, SNIPPET_RESULTS);
         }
 
         /* insert result into index.html */
         size_t pos = html_body.find("<table>") + strlen("<table>");
         if (pos != std::string::npos) {
             std::ostringstream oss;
+            if (terms != input_values) {
+                oss << "<tr><td>Showing results for:";
+                for (auto &term : terms) {
+                    oss << " " << escape_html(term);
+                }
+                oss << "</td></tr>";
+            }
             for (auto &i : result) {
-                oss << "<tr><td>" << i.first << " => " << i.second
-                    << "</td></tr>";
+                oss << "<tr><td>" << i.filepath << " => " << i.score;
+                if (!i.aliases.empty()) {
+                    oss << " (duplicates:";
+                    for (auto &alias : i.aliases) {
+                        oss << " " << alias;
+                    }
+                    oss << ")";
+                }
+                if (!i.snippet.text.empty()) {
+                    oss << "<br><small>" << snippet_to_html(i.snippet) << "</small>";
+                }
+                oss << "</td></tr>";
             }
             std::string result_table = oss.str();
             html_body.insert(pos, result_table);
         } else {
-            std::cerr << "Couldnt find table in html body, no results shown";
+            Logger::error(LogComponent::SESSION, "Couldnt find table in html body, no results shown");
         }
     }
 
     /* send the response with the result */
     beast::ostream(m_response.body()) << html_body;
-    m_response.prepare_payload();
-    http::write(socket, m_response);
 }
 
 std::string Session::read_html_file(const std::string &file_path) {
@@ -27,6 +27,10 @@ class Session : public std::enable_shared_from_this<Session> {
 
    private:
     void write_response();
+    void write_search_page();
+    void write_statistics();
+    void write_suggestions(const std::string &query);
+    void write_batch_search(const std::string &query);
     std::string read_html_file(const std::string &file_path);
 
     boost::asio::ip::tcp::socket socket;
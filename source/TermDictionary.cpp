@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+
+#include "TermDictionary.h"
+
+namespace {
+
+constexpr uint32_t PENDING = UINT32_MAX;
+
+}  // namespace
+
+uint32_t TermDictionary::document_frequency(std::string_view term) const {
+    std::optional<uint32_t> found = find(term);
+    return found ? frequencies[*found] : 0;
+}
+
+/*
+ *   the prefix selects a range of ordinals, the range is scanned for the terms with
+ *   the highest frequencies, blocks whose maximum cant make it into the result are skipped
+ */
+std::vector<DictionaryEntry> TermDictionary::complete(std::string_view prefix, size_t limit) const {
+    if (limit == 0 || frequencies.empty()) {
+        return {};
+    }
+
+    uint32_t state = root;
+    uint32_t begin = 0;
+    for (unsigned char c : prefix) {
+        if (is_final(state)) {
+            begin++;
+        }
+        uint32_t next = PENDING;
+        for (uint32_t t = first_transition[state]; t < first_transition[state + 1]; ++t) {
+            if (labels[t] == c) {
+                next = targets[t];
+                break;
+            }
+            begin += terms_below(targets[t]);
+        }
+        if (next == PENDING) {
+            return {};
+        }
+        state = next;
+    }
+    uint32_t end = begin + terms_below(state);
+
+    /* the top of the heap is the worst candidate, ties go to the smaller ordinal */
+    auto better = [this](uint32_t a, uint32_t b) {
+        return frequencies[a] > frequencies[b] || (frequencies[a] == frequencies[b] && a < b);
+    };
+    std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(better)> best(better);
+    auto offer = [&](uint32_t ordinal) {
+        if (best.size() < limit) {
+            best.push(ordinal);
+        } else if (better(ordinal, best.top())) {
+            best.pop();
+            best.push(ordinal);
+        }
+    };
+
+    uint32_t ordinal = begin;
+    while (ordinal < end) {
+        /* later ordinals lose ties, so a block needs a strictly higher maximum */
+        if (ordinal % BLOCK_SIZE == 0 && ordinal + BLOCK_SIZE <= end && best.size() == limit &&
+            block_max[ordinal / BLOCK_SIZE] <= frequencies[best.top()]) {
+            ordinal += BLOCK_SIZE;
+            continue;
+        }
+        offer(ordinal++);
+    }
+
+    std::vector<DictionaryEntry> result(best.size());
+    for (size_t i = result.size(); i > 0; --i) {
+        result[i - 1] = {term_at(best.top()), frequencies[best.top()]};
+        best.pop();
+    }
+    return result;
+}
+
+/*
+ *   walks the automaton depth first with a row of the edit distance matrix per state,
+ *   which simulates a Levenshtein automaton of the term on the dictionary,
+ *   paths are cut as soon as every entry of the row exceeds the distance
+ */
+std::vector<DictionaryEntry> TermDictionary::fuzzy(std::string_view term, int max_distance, size_t limit) const {
+    if (frequencies.empty()) {
+        return {};
+    }
+
+    std::vector<int> row(term.size() + 1);
+    for (size_t i = 0; i < row.size(); ++i) {
+        row[i] = static_cast<int>(i);
+    }
+    std::vector<std::pair<int, uint32_t>> matches;
+    std::string prefix;
+    fuzzy_search(root, 0, prefix, row, term, max_distance, matches);
+
+    std::sort(matches.begin(), matches.end(), [this](const auto &a, const auto &b) {
+        if (a.first != b.first) {
+            return a.first < b.first;
+        }
+        if (frequencies[a.second] != frequencies[b.second]) {
+            return frequencies[a.second] > frequencies[b.second];
+        }
+        return a.second < b.second;
+    });
+    if (matches.size() > limit) {
+        matches.resize(limit);
+    }
+
+    std::vector<DictionaryEntry> result;
+    for (auto &[distance, ordinal] : matches) {
+        result.push_back({term_at(ordinal), frequencies[ordinal]});
+    }
+    return result;
+}
+
+void TermDictionary::fuzzy_search(uint32_t state, uint32_t base, std::string &prefix, const std::vector<int> &row,
+                                  std::string_view term, int max_distance,
+                                  std::vector<std::pair<int, uint32_t>> &matches) const {
+    if (is_final(state)) {
+        if (row.back() <= max_distance) {
+            matches.emplace_back(row.back(), base);
+        }
+        base++;
+    }
+
+    std::vector<int> next_row(row.size());
+    for (uint32_t t = first_transition[state]; t < first_transition[state + 1]; ++t) {
+        unsigned char c = labels[t];
+        next_row[0] = row[0] + 1;
+        int minimum = next_row[0];
+        for (size_t i = 1; i < row.size(); ++i) {
+            int substitution = row[i - 1] + (static_cast<unsigned char>(term[i - 1]) == c ? 0 : 1);
+            next_row[i] = std::min({row[i] + 1, next_row[i - 1] + 1, substitution});
+            minimum = std::min(minimum, next_row[i]);
+        }
+        if (minimum <= max_distance) {
+            prefix.push_back(static_cast<char>(c));
+            fuzzy_search(targets[t], base, prefix, next_row, term, max_distance, matches);
+            prefix.pop_back();
+        }
+        base += terms_below(targets[t]);
+    }
+}
+
+size_t TermDictionary::get_term_count() const { return frequencies.size(); }
+
+size_t TermDictionary::get_state_count() const { return state_terms.size(); }
+
+size_t TermDictionary::get_transition_count() const { return labels.size(); }
+
+size_t TermDictionary::get_memory_bytes() const {
+    return (first_transition.size() + state_terms.size() + targets.size() + frequencies.size() + block_max.size()) *
+               sizeof(uint32_t) +
+           labels.size();
+}
+
+/* the number of terms before the term in ascending order */
+std::optional<uint32_t> TermDictionary::find(std::string_view term) const {
+    if (frequencies.empty()) {
+        return std::nullopt;
+    }
+
+    uint32_t state = root;
+    uint32_t result = 0;
+    for (unsigned char c : term) {
+        if (is_final(state)) {
+            result++;
+        }
+        uint32_t next = PENDING;
+        for (uint32_t t = first_transition[state]; t < first_transition[state + 1]; ++t) {
+            if (labels[t] == c) {
+                next = targets[t];
+                break;
+            }
+            result += terms_below(targets[t]);
+        }
+        if (next == PENDING) {
+            return std::nullopt;
+        }
+        state = next;
+    }
+    if (!is_final(state)) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+std::string TermDictionary::term_at(uint32_t ordinal) const {
+    std::string term;
+    uint32_t state = root;
+    while (true) {
+        if (is_final(state)) {
+            if (ordinal == 0) {
+                return term;
+            }
+            ordinal--;
+        }
+        uint32_t t = first_transition[state];
+        for (; t < first_transition[state + 1]; ++t) {
+            if (ordinal < terms_below(targets[t])) {
+                break;
+            }
+            ordinal -= terms_below(targets[t]);
+        }
+        if (t == first_transition[state + 1]) {
+            throw std::out_of_range("Term ordinal out of range");
+        }
+        term.push_back(static_cast<char>(labels[t]));
+        state = targets[t];
+    }
+}
+
+bool TermDictionary::is_final(uint32_t state) const { return (state_terms[state] & FINAL) != 0; }
+
+uint32_t TermDictionary::terms_below(uint32_t state) const { return state_terms[state] & ~FINAL; }
+
+TermDictionary::Builder::Builder() : path(1) {}
+
+void TermDictionary::Builder::add(std::string_view term, uint32_t document_frequency) {
+    if (term.empty()) {
+        return;
+    }
+    if (!frequencies.empty() && term <= previous) {
+        throw std::logic_error("Dictionary terms have to be added in ascending order: " + std::string(term));
+    }
+
+    size_t common = 0;
+    while (common < term.size() && common < previous.size() && term[common] == previous[common]) {
+        ++common;
+    }
+    minimize(common);
+
+    for (size_t i = common; i < term.size(); ++i) {
+        path.back().transitions.emplace_back(static_cast<unsigned char>(term[i]), PENDING);
+        path.emplace_back();
+    }
+    path.back().final = true;
+
+    previous.assign(term);
+    frequencies.push_back(document_frequency);
+}
+
+/*
+ *   states are registered children first, so the terms below a state
+ *   can be counted in the order of the state ids
+ */
+TermDictionary TermDictionary::Builder::finish() {
+    minimize(0);
+    uint32_t root = freeze(path.front());
+    path.clear();
+    registry.clear();
+
+    TermDictionary dictionary;
+    dictionary.root = root;
+    dictionary.first_transition.reserve(states.size() + 1);
+    dictionary.state_terms.reserve(states.size());
+    for (auto &state : states) {
+        dictionary.first_transition.push_back(dictionary.labels.size());
+        uint32_t terms = state.final ? 1 : 0;
+        for (auto &[label, target] : state.transitions) {
+            dictionary.labels.push_back(label);
+            dictionary.targets.push_back(target);
+            terms += dictionary.terms_below(target);
+        }
+        dictionary.state_terms.push_back(terms | (state.final ? FINAL : 0));
+    }
+    dictionary.first_transition.push_back(dictionary.labels.size());
+    states.clear();
+
+    dictionary.block_max.resize((frequencies.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    for (size_t i = 0; i < frequencies.size(); ++i) {
+        dictionary.block_max[i / BLOCK_SIZE] = std::max(dictionary.block_max[i / BLOCK_SIZE], frequencies[i]);
+    }
+    dictionary.frequencies = std::move(frequencies);
+    return dictionary;
+}
+
+void TermDictionary::Builder::minimize(size_t depth) {
+    while (path.size() > depth + 1) {
+        uint32_t id = freeze(path.back());
+        path.pop_back();
+        path.back().transitions.back().second = id;
+    }
+}
+
+uint32_t TermDictionary::Builder::freeze(const State &state) {
+    std::string signature(1, state.final ? '1' : '0');
+    for (auto &[label, target] : state.transitions) {
+        signature.push_back(static_cast<char>(label));
+        signature.append(reinterpret_cast<const char *>(&target), sizeof(target));
+    }
+
+    auto [it, inserted] = registry.emplace(std::move(signature), static_cast<uint32_t>(states.size()));
+    if (inserted) {
+        states.push_back(state);
+    }
+    return it->second;
+}
@@ -0,0 +1,114 @@
+#ifndef _H_TERMDICTIONARY
+#define _H_TERMDICTIONARY
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* a term of the dictionary and the number of documents containing it */
+struct DictionaryEntry {
+    std::string term;
+    uint32_t document_frequency;
+};
+
+/*
+ *   Term dictionary of the whole vocabulary as a minimal acyclic automaton (DAWG)
+ *   Terms with common prefixes share their path from the root and terms with
+ *   common suffixes share their states towards the end, so the dictionary is a
+ *   fraction of the size of the terms themselves.
+ *   Every state knows the number of terms below it, which turns the automaton
+ *   into a perfect hash: the ordinal of a term is its position in ascending
+ *   order, the document frequencies are stored in an array by ordinal.
+ *   The terms with a common prefix have consecutive ordinals, completions are
+ *   the terms with the highest document frequency in that range.
+ */
+class TermDictionary {
+   public:
+    class Builder;
+
+    /* 0 if the term is not in the dictionary */
+    uint32_t document_frequency(std::string_view term) const;
+
+    /* the position of the term in ascending order, usable as key of per term arrays */
+    std::optional<uint32_t> find(std::string_view term) const;
+
+    /* up to limit terms starting with the prefix, by descending document frequency */
+    std::vector<DictionaryEntry> complete(std::string_view prefix, size_t limit) const;
+
+    /*
+     *   up to limit terms within max_distance edits (Levenshtein) of the term,
+     *   by ascending distance and then descending document frequency
+     */
+    std::vector<DictionaryEntry> fuzzy(std::string_view term, int max_distance, size_t limit) const;
+
+    size_t get_term_count() const;
+    size_t get_state_count() const;
+    size_t get_transition_count() const;
+    /* bytes used by the automaton and the frequencies */
+    size_t get_memory_bytes() const;
+
+   private:
+    static constexpr uint32_t FINAL = 0x80000000u;
+    /* ordinals per entry of the block maxima, used to skip ranges in completions */
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    std::string term_at(uint32_t ordinal) const;
+
+    bool is_final(uint32_t state) const;
+    uint32_t terms_below(uint32_t state) const;
+
+    void fuzzy_search(uint32_t state, uint32_t base, std::string &prefix, const std::vector<int> &row,
+                      std::string_view term, int max_distance,
+                      std::vector<std::pair<int, uint32_t>> &matches) const;
+
+    uint32_t root = 0;
+    /* transitions of state s are first_transition[s] to first_transition[s + 1] */
+    std::vector<uint32_t> first_transition;
+    /* number of terms reachable from a state, FINAL set if the state ends a term */
+    std::vector<uint32_t> state_terms;
+    /* transitions ordered by label per state */
+    std::vector<unsigned char> labels;
+    std::vector<uint32_t> targets;
+
+    /* document frequency by ordinal and the maximum of every BLOCK_SIZE ordinals */
+    std::vector<uint32_t> frequencies;
+    std::vector<uint32_t> block_max;
+};
+
+/*
+ *   incremental construction from terms in ascending byte order (Daciuk et al.)
+ *   the states of the previous term that are not shared with the next term are
+ *   final and replaced by an equal registered state if there is one
+ */
+class TermDictionary::Builder {
+   public:
+    Builder();
+
+    /* terms have to be added in ascending order, empty terms are ignored */
+    void add(std::string_view term, uint32_t document_frequency);
+    TermDictionary finish();
+
+   private:
+    struct State {
+        bool final = false;
+        std::vector<std::pair<unsigned char, uint32_t>> transitions;
+    };
+
+    /* registers the states of the path deeper than depth */
+    void minimize(size_t depth);
+    uint32_t freeze(const State &state);
+
+    /* the states along the previous term, not registered yet */
+    std::vector<State> path;
+    std::string previous;
+
+    std::vector<State> states;
+    std::unordered_map<std::string, uint32_t> registry;
+    std::vector<uint32_t> frequencies;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef _H_TERMTABLE
+#define _H_TERMTABLE
+
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/* hash for term lookups with std::string, std::pmr::string or std::string_view */
+struct TermHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view term) const { return std::hash<std::string_view>{}(term); }
+};
+
+template <typename Value>
+using TermMap = std::pmr::unordered_map<std::pmr::string, Value, TermHash, std::equal_to<>>;
+
+/*
+ *   term -> value map for one generation of a document
+ *   the nodes, buckets and keys are bump allocated from an arena owned by the table,
+ *   nothing is freed one by one, the memory is released in one shot when the
+ *   table is dropped and replaced by the next generation
+ */
+template <typename Value>
+struct TermTable {
+    /* the arena is declared first, so it outlives the map using it */
+    std::pmr::monotonic_buffer_resource arena;
+    TermMap<Value> terms;
+
+    /* expected_terms is usually the size of the previous generation */
+    explicit TermTable(size_t expected_terms = 0)
+        : arena(expected_terms * BYTES_PER_TERM + MIN_ARENA_SIZE), terms(&arena) {
+        terms.reserve(expected_terms);
+    }
+
+    TermTable(const TermTable &) = delete;
+    TermTable &operator=(const TermTable &) = delete;
+
+   private:
+    /* roughly a hash node, a bucket and a short key */
+    static constexpr size_t BYTES_PER_TERM = 96;
+    static constexpr size_t MIN_ARENA_SIZE = 4096;
+};
+
+#endif
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <zlib.h>
+
+#include "Logger.h"
+#include "TextCache.h"
+
+namespace {
+
+constexpr char MAGIC[4] = {'C', 'T', 'C', '1'};
+constexpr const char *EXTENSION = ".ctc";
+
+/* deflate never compresses better than this, a larger text length is corrupt */
+constexpr uint64_t MAX_COMPRESSION_RATIO = 1032;
+
+/*
+ *   layout of an entry file, followed by the filepath and the compressed text
+ */
+struct EntryHeader {
+    char magic[4];
+    uint32_t path_length;
+    uint64_t file_size;
+    uint64_t file_hash;
+    uint64_t text_length;
+    uint64_t compressed_length;
+};
+
+}  // namespace
+
+TextCache::TextCache(const std::string &directory, uintmax_t max_bytes)
+    : directory(directory), max_bytes(max_bytes) {
+    std::filesystem::create_directories(directory);
+    load_entries();
+    Logger::info(LogComponent::CACHE, "Text cache ", directory, ": ", entries.size(), " entries, ",
+                 total_bytes / 1024, " KiB of ", max_bytes / 1024, " KiB");
+}
+
+std::optional<std::string> TextCache::get(const std::string &filepath, const Fingerprint &fingerprint) {
+    std::string name = entry_name(filepath);
+    std::ifstream file(entry_path(name), std::ios::binary);
+    if (!file.is_open()) {
+        misses++;
+        return std::nullopt;
+    }
+
+    EntryHeader header;
+    std::string stored_path;
+    std::vector<unsigned char> compressed;
+    std::string text;
+    try {
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!file || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            header.file_size != fingerprint.size || header.file_hash != fingerprint.hash) {
+            misses++;
+            return std::nullopt;
+        }
+
+        /* the lengths are checked before anything is allocated for them */
+        uintmax_t entry_size = std::filesystem::file_size(entry_path(name));
+        if (header.compressed_length > entry_size ||
+            sizeof(header) + uint64_t{header.path_length} + header.compressed_length != entry_size ||
+            header.text_length > header.compressed_length * MAX_COMPRESSION_RATIO) {
+            Logger::warn(LogComponent::CACHE, "Corrupt text cache entry for ", filepath);
+            misses++;
+            return std::nullopt;
+        }
+
+        stored_path.resize(header.path_length);
+        file.read(stored_path.data(), header.path_length);
+        compressed.resize(header.compressed_length);
+        file.read(reinterpret_cast<char *>(compressed.data()), header.compressed_length);
+        if (!file || stored_path != filepath) {
+            misses++;
+            return std::nullopt;
+        }
+        text.resize(header.text_length);
+    } catch (std::exception &e) {
+        Logger::warn(LogComponent::CACHE, "Corrupt text cache entry for ", filepath, ": ", e.what());
+        misses++;
+        return std::nullopt;
+    }
+
+    uLongf text_length = header.text_length;
+    if (uncompress(reinterpret_cast<Bytef *>(text.data()), &text_length, compressed.data(), compressed.size()) != Z_OK ||
+        text_length != header.text_length) {
+        Logger::warn(LogComponent::CACHE, "Corrupt text cache entry for ", filepath);
+        misses++;
+        return std::nullopt;
+    }
+
+    touch(name);
+    hits++;
+    return text;
+}
+
+/*
+ *   writes the entry to a temporary file first, so a crash never leaves a
+ *   half written entry behind
+ */
+void TextCache::put(const std::string &filepath, const Fingerprint &fingerprint, const std::string &text) {
+    if (max_bytes == 0) {
+        return;
+    }
+
+    std::vector<unsigned char> compressed(compressBound(text.size()));
+    uLongf compressed_length = compressed.size();
+    if (compress2(compressed.data(), &compressed_length, reinterpret_cast<const Bytef *>(text.data()), text.size(),
+                  Z_DEFAULT_COMPRESSION) != Z_OK) {
+        Logger::warn(LogComponent::CACHE, "Failed to compress text of ", filepath);
+        return;
+    }
+
+    EntryHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.path_length = filepath.size();
+    header.file_size = fingerprint.size;
+    header.file_hash = fingerprint.hash;
+    header.text_length = text.size();
+    header.compressed_length = compressed_length;
+
+    std::string name = entry_name(filepath);
+    std::string path = entry_path(name);
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(filepath.data(), filepath.size());
+        file.write(reinterpret_cast<const char *>(compressed.data()), compressed_length);
+        if (!file) {
+            Logger::warn(LogComponent::CACHE, "Failed to write text cache entry for ", filepath);
+            std::filesystem::remove(tmp_path);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmp_path, path, error);
+    if (error) {
+        Logger::warn(LogComponent::CACHE, "Failed to store text cache entry for ", filepath, ": ", error.message());
+        return;
+    }
+
+    insert(name, sizeof(header) + filepath.size() + compressed_length);
+}
+
+uint64_t TextCache::get_hits() const { return hits; }
+
+uint64_t TextCache::get_misses() const { return misses; }
+
+std::string TextCache::entry_path(const std::string &name) const {
+    return (std::filesystem::path(directory) / (name + EXTENSION)).string();
+}
+
+/* one entry per file, named after the hash of its path */
+std::string TextCache::entry_name(const std::string &filepath) {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx",
+                  static_cast<unsigned long long>(Fingerprint::hash_bytes(filepath.data(), filepath.size())));
+    return name;
+}
+
+void TextCache::load_entries() {
+    std::vector<std::pair<std::filesystem::file_time_type, Entry>> found;
+    for (auto const &dir_entry : std::filesystem::directory_iterator(directory)) {
+        if (!dir_entry.is_regular_file()) {
+            continue;
+        }
+        if (dir_entry.path().extension() != EXTENSION) {
+            /* leftover of an interrupted write */
+            std::filesystem::remove(dir_entry.path());
+            continue;
+        }
+        found.push_back({dir_entry.last_write_time(), {dir_entry.path().stem().string(), dir_entry.file_size()}});
+    }
+
+    std::sort(found.begin(), found.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto &[time, entry] : found) {
+        total_bytes += entry.size;
+        lru.push_back(entry);
+        entries[entry.name] = std::prev(lru.end());
+    }
+    evict();
+}
+
+/* moves the entry to the front and persists the access in its mtime */
+void TextCache::touch(const std::string &name) {
+    std::error_code error;
+    std::filesystem::last_write_time(entry_path(name), std::filesystem::file_time_type::clock::now(), error);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(name);
+    if (it != entries.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+    }
+}
+
+void TextCache::insert(const std::string &name, uintmax_t size) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(name);
+    if (it != entries.end()) {
+        total_bytes -= it->second->size;
+        lru.erase(it->second);
+    }
+
+    lru.push_front({name, size});
+    entries[name] = lru.begin();
+    total_bytes += size;
+    evict();
+}
+
+/* has to be called with the mutex held */
+void TextCache::evict() {
+    while (total_bytes > max_bytes && !lru.empty()) {
+        Entry &oldest = lru.back();
+        std::error_code error;
+        std::filesystem::remove(entry_path(oldest.name), error);
+        Logger::debug(LogComponent::CACHE, "Evicted text cache entry ", oldest.name);
+        total_bytes -= oldest.size;
+        entries.erase(oldest.name);
+        lru.pop_back();
+    }
+}
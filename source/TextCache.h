@@ -0,0 +1,62 @@
+#ifndef _H_TEXTCACHE
+#define _H_TEXTCACHE
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "Fingerprint.h"
+
+/*
+ *   On disk cache of extracted plain text, so PDF and XML files are only
+ *   parsed again if their content changed
+ *   There is one zlib compressed entry per file, it is only valid for the
+ *   fingerprint (size and content hash) it was written with.
+ *   The total size of the entries is capped, the least recently used entries
+ *   are removed first, the recency survives restarts via the entry mtime.
+ */
+class TextCache {
+   public:
+    TextCache(const std::string &directory, uintmax_t max_bytes);
+
+    /* returns the cached text if there is an entry matching the fingerprint */
+    std::optional<std::string> get(const std::string &filepath, const Fingerprint &fingerprint);
+    void put(const std::string &filepath, const Fingerprint &fingerprint, const std::string &text);
+
+    /* statistics */
+    uint64_t get_hits() const;
+    uint64_t get_misses() const;
+
+   private:
+    struct Entry {
+        std::string name;
+        uintmax_t size;
+    };
+
+    std::string entry_path(const std::string &name) const;
+    static std::string entry_name(const std::string &filepath);
+
+    /* reads existing entries into the lru list, oldest last */
+    void load_entries();
+    void touch(const std::string &name);
+    void insert(const std::string &name, uintmax_t size);
+    void evict();
+
+    std::string directory;
+    uintmax_t max_bytes;
+
+    std::mutex mtx;
+    /* most recently used entries first */
+    std::list<Entry> lru;
+    std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+    uintmax_t total_bytes = 0;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include <stdexcept>
+
+#include "Logger.h"
+#include "ThreadPool.h"
+
+namespace {
+
+/* the pool and index of the worker running on this thread */
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t thread_count) : started(std::chrono::steady_clock::now()) {
+    thread_count = std::max<size_t>(thread_count, 1);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back([this, i]() { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() { shutdown(); }
+
+/*
+ *   a worker pushes to its own deque, other threads to the next worker in turn,
+ *   the pending counter is changed under the wake mutex so no worker misses it
+ */
+void ThreadPool::submit(std::function<void()> task) {
+    size_t index = (current_pool == this) ? current_worker : next_worker++ % workers.size();
+    {
+        std::lock_guard<std::mutex> lock(wake_mtx);
+        if (stopping) {
+            throw std::logic_error("Task submitted to a stopped thread pool");
+        }
+        pending++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mtx);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mtx);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    Statistics statistics = get_statistics();
+    Logger::debug(LogComponent::INDEX, "Thread pool stopped: ", statistics.tasks, " tasks, ", statistics.steals,
+                  " steals, utilization ", statistics.utilization);
+}
+
+size_t ThreadPool::get_thread_count() const { return workers.size(); }
+
+ThreadPool::Statistics ThreadPool::get_statistics() const {
+    Statistics statistics{};
+    statistics.threads = workers.size();
+    statistics.tasks = tasks_run;
+    statistics.steals = steals;
+
+    uint64_t busy = caller_busy_nanoseconds;
+    for (auto &worker : workers) {
+        busy += worker->busy_nanoseconds;
+    }
+    auto lifetime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+    statistics.utilization = lifetime.count() == 0 ? 0.0
+        : static_cast<double>(busy) / (static_cast<double>(lifetime.count()) * workers.size());
+    return statistics;
+}
+
+/* queued tasks are finished before a worker stops */
+void ThreadPool::run(size_t index) {
+    current_pool = this;
+    current_worker = index;
+
+    std::function<void()> task;
+    while (true) {
+        if (take_task(index, task)) {
+            auto start = std::chrono::steady_clock::now();
+            try {
+                task();
+            } catch (std::exception &e) {
+                Logger::error(LogComponent::INDEX, "Uncaught exception in thread pool task: ", e.what());
+            }
+            task = nullptr;
+            workers[index]->busy_nanoseconds +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            tasks_run++;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mtx);
+        wake.wait(lock, [this]() { return stopping || pending > 0; });
+        if (stopping && pending == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::add_caller_time(std::chrono::steady_clock::time_point start) {
+    if (current_pool == this) {
+        return;
+    }
+    caller_busy_nanoseconds +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* the newest task of the own deque, otherwise the oldest task of another worker */
+bool ThreadPool::take_task(size_t index, std::function<void()> &task) {
+    {
+        Worker &own = *workers[index];
+        std::lock_guard<std::mutex> lock(own.mtx);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            pending--;
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < workers.size(); ++offset) {
+        Worker &victim = *workers[(index + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending--;
+            steals++;
+            return true;
+        }
+    }
+    return false;
+}
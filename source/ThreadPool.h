@@ -0,0 +1,145 @@
+#ifndef _H_THREADPOOL
+#define _H_THREADPOOL
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ *   Persistent work stealing thread pool, shared by the indexing phases
+ *   Every worker has its own task deque, it runs its newest task first and
+ *   when it runs out of tasks it steals the oldest task of another worker,
+ *   so small tasks of uneven size are spread over all workers.
+ *   Tasks submitted from outside the pool are distributed round robin.
+ */
+class ThreadPool {
+   public:
+    explicit ThreadPool(size_t thread_count);
+    /* finishes the queued tasks and joins the workers */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+
+    /*
+     *   calls fn(i) for every i in [begin, end), grain indexes per task,
+     *   the calling thread runs chunks of this loop until all are claimed,
+     *   never other queued tasks, the first exception thrown by fn is rethrown
+     */
+    template <typename Fn>
+    void parallel_for(size_t begin, size_t end, size_t grain, Fn &&fn);
+
+    /* stops accepting tasks, finishes the queued ones and joins the workers */
+    void shutdown();
+
+    size_t get_thread_count() const;
+
+    struct Statistics {
+        size_t threads;
+        uint64_t tasks;
+        uint64_t steals;
+        /*
+         *   share of the lifetime of the workers spent running tasks, including
+         *   the chunks run by threads outside the pool waiting in parallel_for
+         */
+        double utilization;
+    };
+    Statistics get_statistics() const;
+
+   private:
+    struct alignas(64) Worker {
+        std::mutex mtx;
+        std::deque<std::function<void()>> tasks;
+        std::atomic<uint64_t> busy_nanoseconds{0};
+    };
+
+    void run(size_t index);
+    /* time a thread outside the pool spent on chunks, workers count their tasks already */
+    void add_caller_time(std::chrono::steady_clock::time_point start);
+    bool take_task(size_t index, std::function<void()> &task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point started;
+
+    /* sleeping workers wait for queued tasks */
+    std::mutex wake_mtx;
+    std::condition_variable wake;
+    std::atomic<size_t> pending{0};
+    bool stopping = false;
+
+    std::atomic<size_t> next_worker{0};
+    std::atomic<uint64_t> tasks_run{0};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<uint64_t> caller_busy_nanoseconds{0};
+};
+
+template <typename Fn>
+void ThreadPool::parallel_for(size_t begin, size_t end, size_t grain, Fn &&fn) {
+    if (begin >= end) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+
+    struct State {
+        std::atomic<size_t> next_chunk{0};
+        std::atomic<size_t> remaining;
+        std::mutex mtx;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    size_t chunk_count = (end - begin + grain - 1) / grain;
+    state->remaining = chunk_count;
+
+    /* every task claims the next chunk, the ones finding none left return */
+    auto run_chunk = [state, &fn, begin, end, grain, chunk_count]() {
+        size_t chunk = state->next_chunk++;
+        if (chunk >= chunk_count) {
+            return false;
+        }
+        try {
+            for (size_t i = begin + chunk * grain; i < std::min(end, begin + (chunk + 1) * grain); ++i) {
+                fn(i);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            if (!state->error) {
+                state->error = std::current_exception();
+            }
+        }
+        if (--state->remaining == 0) {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            state->done.notify_all();
+        }
+        return true;
+    };
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        submit([run_chunk]() { run_chunk(); });
+    }
+
+    /* help with the chunks of this loop, then wait for the ones still running */
+    auto start = std::chrono::steady_clock::now();
+    while (run_chunk()) {
+    }
+    add_caller_time(start);
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->done.wait(lock, [&state]() { return state->remaining == 0; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+#endif
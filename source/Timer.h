@@ -4,6 +4,7 @@
 #include <boost/asio.hpp>
 
 #include "Index.h"
+#include "Logger.h"
 
 class Timer {
    public:
@@ -28,12 +29,12 @@ class Timer {
 
     void async_handler(const boost::system::error_code &error) {
         if (!error) {
-            std::cout << "Timer expired!" << std::endl;
+            Logger::debug(LogComponent::TIMER, "Timer expired!");
             m_idx.run_reindexing();
             /* reschedule the timer */
             start_timer();
         } else {
-            std::cerr << "Error occured on timer: " << error.message() << std::endl;
+            Logger::error(LogComponent::TIMER, "Error occured on timer: ", error.message());
         }
     }
 };
@@ -1,7 +1,7 @@
-#include <iostream>
 #include <queue>
 
 #include "XMLContentStrategy.h"
+#include "Logger.h"
 
 /* XML Specific Documents */
 XMLContentStrategy::XMLContentStrategy() {}
@@ -11,7 +11,7 @@ std::string XMLContentStrategy::read_content(const std::string &filepath) const
     std::string file_content;
 
     if (!doc.load_file(filepath.c_str())) {
-        std::cerr << "failed to load xml file" << std::endl;
+        Logger::error(LogComponent::DOCUMENT, "failed to load xml file: ", filepath);
     }
 
     traverse_nodes(doc.document_element(), file_content);
@@ -7,15 +7,32 @@
 
 /* cearch headers */
 #include "Index.h"
+#include "Logger.h"
 #include "Server.h"
 #include "Timer.h"
 
 int main(int argc, const char *argv[]) {
     /* read configuration from command line */
-    if (argc != 6) {
+    if (argc < 6) {
         std::cerr << "Usage: ./cearch <Port> <Directory to index> <directory ";
         std::cerr << "to save index in> <number of threads to use>";
-        std::cerr << "<timer in seconds for reindexing>";
+        std::cerr << "<timer in seconds for reindexing> [options]" << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --log-level=<spec>  e.g. info,index=debug,session=warn";
+        std::cerr << std::endl;
+        std::cerr << "  --text-cache-size=<MiB>  size of the extracted text cache, 0 disables it";
+        std::cerr << std::endl;
+        std::cerr << "  --max-build-memory=<MiB>  build the index as on disk segments with this memory budget";
+        std::cerr << std::endl;
+        std::cerr << "  --merge-factor=<n>  number of similar sized segments merged into one";
+        std::cerr << std::endl;
+        std::cerr << "  --merge-rate=<MiB/s>  write rate of background merges, 0 is unlimited";
+        std::cerr << std::endl;
+        std::cerr << "  --store-documents=<0|1>  keep the compressed document text for result snippets";
+        std::cerr << std::endl;
+        std::cerr << "  --index-layout=<tfidf|impact>  impact keeps quantized scores ordered by impact";
+        std::cerr << std::endl;
+        std::cerr << "  --impact-budget=<n>  postings scored per query with the impact layout, 0 scores all";
         std::cerr << std::endl;
         return 1;
     }
@@ -26,6 +43,51 @@ int main(int argc, const char *argv[]) {
     int threads = atoi(argv[4]);
     int tick = atoi(argv[5]);
 
+    /* optional settings, given as --name=value after the positional arguments */
+    IndexConfig config;
+    for (int i = 6; i < argc; ++i) {
+        std::string option = argv[i];
+        size_t pos = option.find('=');
+        std::string name = option.substr(0, pos);
+        std::string value = (pos == std::string::npos) ? "" : option.substr(pos + 1);
+
+        try {
+            if (name == "--log-level") {
+                Logger::instance().configure(value);
+            } else if (name == "--text-cache-size") {
+                config.text_cache_bytes = std::stoull(value) * 1024 * 1024;
+            } else if (name == "--max-build-memory") {
+                config.max_build_memory = std::stoull(value) * 1024 * 1024;
+            } else if (name == "--merge-factor") {
+                config.merge_factor = std::stoull(value);
+            } else if (name == "--merge-rate") {
+                config.merge_bytes_per_second = std::stoull(value) * 1024 * 1024;
+            } else if (name == "--store-documents") {
+                config.store_documents = std::stoi(value) != 0;
+            } else if (name == "--index-layout") {
+                if (value == "tfidf") {
+                    config.layout = IndexLayout::TFIDF;
+                } else if (value == "impact") {
+                    config.layout = IndexLayout::IMPACT;
+                } else {
+                    throw std::invalid_argument("expected tfidf or impact");
+                }
+            } else if (name == "--impact-budget") {
+                config.impact_budget = std::stoull(value);
+            } else {
+                std::cerr << "Unknown option: " << option << std::endl;
+                return 1;
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Invalid option " << option << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (config.layout == IndexLayout::IMPACT && config.max_build_memory > 0) {
+        std::cerr << "The impact layout is kept in memory and cant be combined with --max-build-memory" << std::endl;
+        return 1;
+    }
+
     try {
         /* create io context */
         boost::asio::io_context io_context;
@@ -34,14 +96,14 @@ int main(int argc, const char *argv[]) {
         *   init the index and timer 
         *   TODO: Make indexing asynchronous
         */
-        Index idx(directory, index_path, threads);
+        Index idx(directory, index_path, threads, config);
         Timer timer(tick, io_context, idx);
 
-        std::cout << "Starting cearch server on port: " << port << std::endl;
+        Logger::info(LogComponent::MAIN, "Starting cearch server on port: ", port);
         Server server(io_context, port, idx);
         io_context.run();
     } catch (const std::exception &e) {
-        std::cerr << "Error in main: " << e.what() << std::endl;
+        Logger::error(LogComponent::MAIN, "Error in main: ", e.what());
         return 2;
     }
 
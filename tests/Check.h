@@ -0,0 +1,39 @@
+#ifndef _H_CHECK
+#define _H_CHECK
+
+#include <iostream>
+
+/*
+ *   minimal assertions for the test programs, a failed check is reported
+ *   and makes the program exit with an error after all checks ran
+ */
+inline int failed_checks = 0;
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; \
+            failed_checks++;                                                               \
+        }                                                                                  \
+    } while (false)
+
+#define CHECK_EQUAL(actual, expected)                                                               \
+    do {                                                                                            \
+        auto actual_value = (actual);                                                               \
+        auto expected_value = (expected);                                                           \
+        if (!(actual_value == expected_value)) {                                                    \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #actual " == " #expected \
+                      << " (" << actual_value << " != " << expected_value << ")\n";                 \
+            failed_checks++;                                                                        \
+        }                                                                                           \
+    } while (false)
+
+inline int check_result() {
+    if (failed_checks > 0) {
+        std::cerr << failed_checks << " checks failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+#endif
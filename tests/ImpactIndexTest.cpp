@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Check.h"
+#include "ImpactIndex.h"
+
+/*
+ *   a single long document with a very high term frequency must not push
+ *   the postings of all other documents down to the same impact, on a linear
+ *   scale every tf up to 39 was impact 1, on the log scale the small term
+ *   frequencies stay apart until neighbours are less than a level apart
+ */
+void quantize_keeps_term_frequencies_apart() {
+    const double idf = 1.5;
+    const double max_score = 5000 * 2.0;
+
+    uint8_t previous = 0;
+    for (int tf = 1; tf <= 32; ++tf) {
+        uint8_t impact = ImpactIndex::quantize(tf * idf, max_score);
+        CHECK(impact > previous);
+        previous = impact;
+    }
+    for (int tf = 33; tf < 40; ++tf) {
+        CHECK(ImpactIndex::quantize(tf * idf, max_score) >= previous);
+    }
+    CHECK(ImpactIndex::quantize(39 * idf, max_score) > 100);
+    CHECK_EQUAL(int{ImpactIndex::quantize(max_score, max_score)}, 255);
+    CHECK_EQUAL(int{ImpactIndex::quantize(0.0, max_score)}, 0);
+}
+
+/* documents with a higher term frequency still rank first next to an outlier */
+void query_ranks_by_term_frequency() {
+    const double idf = 1.5;
+    const double max_score = 5000 * 2.0;
+
+    std::vector<ImpactPosting> postings;
+    for (uint32_t doc_id = 0; doc_id < 5; ++doc_id) {
+        postings.push_back({0, doc_id, ImpactIndex::quantize((doc_id + 1) * idf, max_score)});
+    }
+    postings.push_back({1, 5, ImpactIndex::quantize(max_score, max_score)});
+    ImpactIndex index(postings, 2, 6, max_score);
+
+    /* the results are unordered, document n has term frequency n + 1 */
+    std::vector<std::pair<uint32_t, double>> result = index.query({0}, 0);
+    std::sort(result.begin(), result.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+    CHECK_EQUAL(result.size(), size_t{5});
+    for (size_t i = 0; i < result.size(); ++i) {
+        CHECK_EQUAL(result[i].first, static_cast<uint32_t>(4 - i));
+    }
+    for (size_t i = 1; i < result.size(); ++i) {
+        CHECK(result[i - 1].second > result[i].second);
+    }
+    /* scores are log(1 + tfidf), up to the quantization */
+    CHECK(std::abs(result.back().second - std::log1p(idf)) < std::log1p(max_score) / 255);
+}
+
+int main() {
+    quantize_keeps_term_frequencies_apart();
+    query_ranks_by_term_frequency();
+    return check_result();
+}
@@ -0,0 +1,49 @@
+#include <filesystem>
+
+#include "Check.h"
+#include "SegmentIndex.h"
+
+class SegmentIndexTest {
+   public:
+    static std::vector<SegmentIndex::LiveSegment> snapshot(SegmentIndex &index) { return index.snapshot(); }
+    static bool merge(SegmentIndex &index, const std::vector<SegmentIndex::LiveSegment> &inputs) {
+        return index.merge(inputs);
+    }
+
+    /*
+     *   a document deleted from segment A and reindexed into segment B has to stay
+     *   searchable when A and B are merged while another document of A is deleted
+     */
+    static void merge_keeps_reindexed_document(const std::string &directory) {
+        /* no tier fills up with a merge factor this large, the test runs all merges */
+        SegmentIndex index(directory, 64 * 1024 * 1024, 100, 0);
+
+        for (uint32_t doc_id = 0; doc_id < 10; ++doc_id) {
+            index.add_posting("every", doc_id, 1, 0);
+        }
+        index.add_posting("only", 0, 1, 0);
+        index.flush();
+
+        index.remove_documents({0});
+        index.add_posting("every", 0, 1, 0);
+        index.add_posting("only", 0, 1, 0);
+        index.flush();
+
+        std::vector<SegmentIndex::LiveSegment> inputs = snapshot(index);
+        CHECK_EQUAL(inputs.size(), size_t{2});
+
+        index.remove_documents({1});
+        CHECK(merge(index, inputs));
+
+        CHECK_EQUAL(snapshot(index).size(), size_t{1});
+        CHECK_EQUAL(index.find("only").size(), size_t{1});
+        CHECK_EQUAL(index.find("every").size(), size_t{9});
+    }
+};
+
+int main() {
+    std::string directory = (std::filesystem::temp_directory_path() / "cearch-segment-index-test").string();
+    SegmentIndexTest::merge_keeps_reindexed_document(directory);
+    std::filesystem::remove_all(directory);
+    return check_result();
+}